@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+namespace Factory {
+
+    /**
+     * Source of simulated time for machines and controller loops.
+     * Every simulated delay (transport, processing, retry back-off, generation and
+     * spawn intervals) goes through a Clock, so the same topology can run in real
+     * time, in scaled time or in fully virtual time.
+     */
+    class Clock {
+    public:
+        using Duration = std::chrono::nanoseconds;
+        using TimePoint = std::chrono::time_point<std::chrono::steady_clock, Duration>;
+
+        virtual ~Clock() = default;
+
+        /** Current simulated time. */
+        virtual TimePoint Now() const noexcept = 0;
+
+        /** Blocks the calling thread for the given amount of simulated time.
+         *
+         * Exception guarantee: no-throw in all provided clocks
+         */
+        virtual void SleepFor(Duration duration) = 0;
+
+        void SleepUntil(TimePoint deadline) {
+            auto now = Now();
+            if (deadline > now) {
+                SleepFor(deadline - now);
+            }
+        }
+    };
+
+    // Simulated time equals wall-clock time
+    class RealTimeClock : public Clock {
+    public:
+        TimePoint Now() const noexcept override {
+            return std::chrono::time_point_cast<Duration>(std::chrono::steady_clock::now());
+        }
+
+        void SleepFor(Duration duration) override {
+            std::this_thread::sleep_for(duration);
+        }
+    };
+
+    // Simulated time runs `factor` times faster than wall-clock time
+    class ScaledClock : public Clock {
+    public:
+        /**
+         * @param factor speed-up relative to real time, e.g. 60.0 runs a minute per second
+         * @throws std::invalid_argument if factor is not positive
+         */
+        explicit ScaledClock(double factor)
+            : factor_(factor), start_(std::chrono::steady_clock::now()) {
+            if (!(factor > 0.0)) {
+                throw std::invalid_argument("ScaledClock factor must be positive");
+            }
+        }
+
+        TimePoint Now() const noexcept override {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            return TimePoint(std::chrono::duration_cast<Duration>(elapsed * factor_));
+        }
+
+        void SleepFor(Duration duration) override {
+            std::this_thread::sleep_for(std::chrono::duration_cast<Duration>(duration / factor_));
+        }
+
+    private:
+        double factor_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    /**
+     * Fully virtual "as fast as possible" clock.
+     * Sleeping threads never wait for wall-clock time. Instead, once no thread has
+     * entered or left a sleep for a short quiescence period, time jumps straight to
+     * the earliest pending wake-up. Sleepers are therefore woken in deadline order,
+     * like a discrete-event simulation, while all non-sleeping work runs at full speed.
+     */
+    class VirtualClock : public Clock {
+    public:
+        explicit VirtualClock(Duration quiescence = std::chrono::microseconds(200)) noexcept
+            : quiescence_(quiescence) {}
+
+        TimePoint Now() const noexcept override {
+            return TimePoint(Duration(now_.load()));
+        }
+
+        void SleepFor(Duration duration) override {
+            std::unique_lock<std::mutex> lock(mutex_);
+            const Duration deadline = Duration(now_.load()) + duration;
+            auto self = sleepers_.insert(deadline);
+            ++epoch_;
+
+            while (Duration(now_.load()) < deadline) {
+                const auto seen = epoch_;
+                if (cv_.wait_for(lock, quiescence_) == std::cv_status::timeout && seen == epoch_) {
+                    // Nothing happened for a full quiescence period: advance to the next wake-up
+                    auto next = sleepers_.upper_bound(Duration(now_.load()));
+                    if (next != sleepers_.end()) {
+                        now_.store(next->count());
+                        ++epoch_;
+                        cv_.notify_all();
+                    }
+                }
+            }
+
+            sleepers_.erase(self);
+            ++epoch_;
+        }
+
+    private:
+        Duration quiescence_;
+        std::atomic<Duration::rep> now_{0};
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::multiset<Duration> sleepers_;
+        unsigned long epoch_{0};
+    };
+
+    // Clock used by machines that are not registered through a Controller
+    inline Clock& DefaultClock() {
+        static RealTimeClock clock;
+        return clock;
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <utility>
+
+namespace Factory::Concurrency {
+
+    /**
+     * Unbounded lock-free multi-producer / single-consumer queue (Vyukov's intrusive
+     * node queue). Push is wait-free apart from the node allocation; only the single
+     * consumer thread may call TryPop/WaitPop/Empty.
+     *
+     * WaitPop spins briefly before parking on an atomic wait, and producers only issue
+     * a notify when the consumer is actually parked.
+     */
+    template<class T>
+    class MpscQueue {
+    public:
+        // Busy-spin iterations followed by yielding iterations before the consumer parks
+        static constexpr int BUSY_SPINS = 64;
+        static constexpr int YIELD_SPINS = 16;
+
+        MpscQueue() : head_(new Node), tail_(head_.load(std::memory_order_relaxed)) {}
+
+        ~MpscQueue() {
+            while (TryPop()) {}
+            delete tail_;
+        }
+
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        /** Appends a value. Safe to call from any number of threads.
+         *
+         * @throws std::bad_alloc if the node cannot be allocated
+         * Exception guarantee: strong
+         */
+        void Push(T value) {
+            auto* node = new Node(std::move(value));
+            Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+            Notify();
+        }
+
+        /** Consumer only. Returns the oldest value, or std::nullopt if the queue is empty. */
+        std::optional<T> TryPop() {
+            Node* next = tail_->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                return std::nullopt;
+            }
+            std::optional<T> value(std::move(next->value));
+            next->value.reset();
+            delete tail_;
+            tail_ = next;
+            return value;
+        }
+
+        /** Consumer only. Blocks until a value is available or `stop()` returns true.
+         * `stop` is evaluated before each pop, so a stop request wins over queued values.
+         *
+         * @return the value, or std::nullopt when stopped
+         */
+        template<class StopFn>
+        std::optional<T> WaitPop(StopFn&& stop) {
+            int spins = 0;
+            while (true) {
+                if (stop()) {
+                    return std::nullopt;
+                }
+                if (auto value = TryPop()) {
+                    return value;
+                }
+                if (spins < BUSY_SPINS + YIELD_SPINS) {
+                    if (spins++ >= BUSY_SPINS) {
+                        std::this_thread::yield();
+                    }
+                    continue;
+                }
+
+                // Park: announce ourselves, then re-check before sleeping so a concurrent
+                // Push either sees the announcement or its value is seen here
+                const auto seen = signal_.load(std::memory_order_acquire);
+                parked_.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!stop() && Empty()) {
+                    signal_.wait(seen, std::memory_order_acquire);
+                }
+                parked_.store(false, std::memory_order_relaxed);
+                spins = 0;
+            }
+        }
+
+        /** Wakes the consumer if it is parked, e.g. after a stop flag was raised. */
+        void Notify() noexcept {
+            signal_.fetch_add(1, std::memory_order_release);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (parked_.load(std::memory_order_relaxed)) {
+                signal_.notify_one();
+            }
+        }
+
+        /** Consumer only. */
+        bool Empty() const noexcept {
+            return tail_->next.load(std::memory_order_acquire) == nullptr;
+        }
+
+    private:
+        struct Node {
+            Node() = default;
+            explicit Node(T&& v) : value(std::move(v)) {}
+
+            std::atomic<Node*> next{nullptr};
+            std::optional<T> value;
+        };
+
+        alignas(64) std::atomic<Node*> head_;       // producers
+        alignas(64) Node* tail_;                    // consumer
+        alignas(64) std::atomic<std::uint32_t> signal_{0};
+        std::atomic_bool parked_{false};
+    };
+}
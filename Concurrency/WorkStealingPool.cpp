@@ -0,0 +1,282 @@
+#include "WorkStealingPool.hpp"
+#include "../Logging/Logger.hpp"
+#include "../Tracing/Tracer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+
+namespace Factory::Concurrency {
+
+    namespace {
+        thread_local const WorkStealingPool* currentPool = nullptr;
+        thread_local size_t currentIndex = NO_WORKER;
+        thread_local std::minstd_rand stealRng;
+    }
+
+    void WorkStealingPool::Start(size_t minWorkers, size_t maxWorkers, Source source) {
+        if (minWorkers == 0 || minWorkers > maxWorkers || maxWorkers > MAX_POOL_WORKERS) {
+            throw std::invalid_argument("[SCHEDULER] worker bounds must satisfy 0 < min <= max <= "
+                                        + std::to_string(MAX_POOL_WORKERS));
+        }
+        std::lock_guard<std::mutex> lock(lifecycleMutex_);
+        if (running_.load()) {
+            throw std::logic_error("[SCHEDULER] already running");
+        }
+        minWorkers_ = minWorkers;
+        maxWorkers_ = maxWorkers;
+        source_ = std::move(source);
+        stop_.store(false);
+        running_.store(true);
+        for (size_t i = 0; i < minWorkers; ++i) {
+            StartWorker(i);
+        }
+    }
+
+    void WorkStealingPool::Stop() noexcept {
+        std::lock_guard<std::mutex> lock(lifecycleMutex_);
+        if (!running_.exchange(false)) {
+            return;
+        }
+        stop_.store(true);
+        const size_t slots = highWater_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < slots; ++i) {
+            { std::lock_guard<std::mutex> guard(workers_[i].mutex); }
+            workers_[i].cv.notify_all();
+        }
+        for (size_t i = 0; i < slots; ++i) {
+            auto& worker = workers_[i];
+            if (worker.thread.joinable()) {
+                try {
+                    worker.thread.join();
+                } catch (...) {
+                    FACTORY_LOG_ERROR("[ERROR] Failed to join worker thread");
+                }
+            }
+            std::lock_guard<std::mutex> guard(worker.mutex);
+            worker.active = false;
+        }
+        activeCount_.store(0);
+    }
+
+    void WorkStealingPool::Submit(Task task, size_t hint) {
+        if (hint == NO_WORKER) {
+            hint = CurrentWorker();
+        }
+        const size_t slots = std::max<size_t>(highWater_.load(std::memory_order_acquire), 1);
+        size_t index = hint < slots ? hint : cursor_.fetch_add(1, std::memory_order_relaxed) % slots;
+        while (true) {
+            auto& worker = workers_[index];
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            // Before Start and while stopping, any slot holds the task; otherwise only running workers
+            if (worker.active || !running_.load(std::memory_order_acquire)) {
+                worker.tasks.push_back(std::move(task));
+                const size_t depth = worker.tasks.size();
+                worker.size.store(depth, std::memory_order_relaxed);
+                queued_.fetch_add(1, std::memory_order_relaxed);
+                const bool sleeping = worker.sleeping;
+                lock.unlock();
+
+                if (sleeping) {
+                    worker.cv.notify_one();
+                } else if (depth > 1) {
+                    WakeIdle(); // the owner is busy with a backlog: let someone steal
+                }
+                MaybeGrow(0);
+                return;
+            }
+            lock.unlock();
+            index = cursor_.fetch_add(1, std::memory_order_relaxed) % slots; // hinted worker retired
+        }
+    }
+
+    void WorkStealingPool::Notify(size_t backlog) noexcept {
+        WakeIdle();
+        MaybeGrow(backlog);
+    }
+
+    size_t WorkStealingPool::CurrentWorker() const noexcept {
+        return currentPool == this ? currentIndex : NO_WORKER;
+    }
+
+    void WorkStealingPool::Run(size_t index) {
+        currentPool = this;
+        currentIndex = index;
+        stealRng.seed(static_cast<std::minstd_rand::result_type>(index + 1));
+        auto& self = workers_[index];
+        FACTORY_LOG_INFO("[WORKER ", index, "] Started");
+        FACTORY_TRACE(SetThreadName, "worker " + std::to_string(index));
+
+        while (true) {
+            // Read before looking for work, so an announcement made meanwhile prevents sleeping
+            const auto seen = epoch_.load();
+
+            Task task = PopLocal(self);
+            if (!task) {
+                task = Steal(index);
+            }
+            if (!task && source_ && !stop_.load()) {
+                try {
+                    task = source_();
+                } catch (const std::exception& e) {
+                    FACTORY_LOG_ERROR("[WORKER ", index, "] Fetching work failed: ", e.what());
+                }
+            }
+            if (task) {
+                try {
+                    task();
+                } catch (const std::exception& e) {
+                    FACTORY_LOG_ERROR("[WORKER ", index, "] Task failed: ", e.what());
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(self.mutex);
+            if (!self.tasks.empty()) {
+                continue;
+            }
+            if (stop_.load()) {
+                break; // drained: nothing local and nothing left to steal
+            }
+            self.sleeping = true;
+            idle_.fetch_add(1);
+            const bool woken = self.cv.wait_for(lock, std::chrono::milliseconds(POOL_IDLE_RETIRE_MS), [&] {
+                return !self.tasks.empty() || stop_.load() || epoch_.load() != seen;
+            });
+            idle_.fetch_sub(1);
+            self.sleeping = false;
+            if (!woken && TryRetire(self)) {
+                lock.unlock();
+                FACTORY_LOG_INFO("[WORKER ", index, "] Retired after idling, ", WorkerCount(), " running");
+                currentPool = nullptr;
+                return;
+            }
+        }
+
+        currentPool = nullptr;
+        FACTORY_LOG_INFO("[WORKER ", index, "] Stopped");
+    }
+
+    WorkStealingPool::Task WorkStealingPool::PopLocal(Worker& worker) {
+        if (worker.size.load(std::memory_order_relaxed) == 0) {
+            return {};
+        }
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) {
+            return {};
+        }
+        // Newest first: its data is the most likely to still be in this core's cache
+        Task task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        worker.size.store(worker.tasks.size(), std::memory_order_relaxed);
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        return task;
+    }
+
+    WorkStealingPool::Task WorkStealingPool::Steal(size_t thief) {
+        const size_t slots = highWater_.load(std::memory_order_acquire);
+        if (slots < 2) {
+            return {};
+        }
+        const size_t start = stealRng() % slots;
+        for (size_t i = 0; i < slots; ++i) {
+            const size_t victim = (start + i) % slots;
+            auto& worker = workers_[victim];
+            if (victim == thief || worker.size.load(std::memory_order_relaxed) == 0) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (worker.tasks.empty()) {
+                continue;
+            }
+            // Oldest first: the owner keeps the recent work it is likely to continue
+            Task task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+            worker.size.store(worker.tasks.size(), std::memory_order_relaxed);
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            FACTORY_LOG_DEBUG("[WORKER ", thief, "] Stole a task from worker ", victim);
+            return task;
+        }
+        return {};
+    }
+
+    void WorkStealingPool::WakeIdle() noexcept {
+        epoch_.fetch_add(1);
+        if (idle_.load() == 0) {
+            return; // a worker about to sleep sees the new epoch instead
+        }
+        const size_t slots = highWater_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < slots; ++i) {
+            auto& worker = workers_[i];
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            if (worker.sleeping) {
+                lock.unlock();
+                worker.cv.notify_one();
+                return;
+            }
+        }
+    }
+
+    void WorkStealingPool::MaybeGrow(size_t backlog) noexcept {
+        const size_t count = activeCount_.load(std::memory_order_relaxed);
+        if (!running_.load(std::memory_order_relaxed) || count >= maxWorkers_
+            || queued_.load(std::memory_order_relaxed) + backlog <= count * POOL_GROW_THRESHOLD) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(lifecycleMutex_, std::try_to_lock);
+        if (!lock.owns_lock() || !running_.load() || activeCount_.load() >= maxWorkers_) {
+            return; // someone else is already growing or stopping the pool
+        }
+        for (size_t i = 0; i < maxWorkers_; ++i) {
+            bool active;
+            {
+                std::lock_guard<std::mutex> guard(workers_[i].mutex);
+                active = workers_[i].active;
+            }
+            if (!active) {
+                try {
+                    StartWorker(i);
+                } catch (const std::exception& e) {
+                    FACTORY_LOG_WARN("[SCHEDULER] Failed to start worker ", i, ": ", e.what());
+                }
+                return;
+            }
+        }
+    }
+
+    void WorkStealingPool::StartWorker(size_t index) {
+        auto& worker = workers_[index];
+        if (worker.thread.joinable()) {
+            worker.thread.join(); // retired earlier; it has left Run already or is about to
+        }
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.active = true;
+        }
+        const size_t count = activeCount_.fetch_add(1) + 1;
+        if (index >= highWater_.load(std::memory_order_relaxed)) {
+            highWater_.store(index + 1, std::memory_order_release);
+        }
+        try {
+            worker.thread = std::thread(&WorkStealingPool::Run, this, index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.active = false;
+            activeCount_.fetch_sub(1);
+            throw;
+        }
+        FACTORY_LOG_INFO("[SCHEDULER] Started worker ", index, ", ", count, " running");
+    }
+
+    bool WorkStealingPool::TryRetire(Worker& worker) noexcept {
+        size_t count = activeCount_.load();
+        while (count > minWorkers_) {
+            if (activeCount_.compare_exchange_weak(count, count - 1)) {
+                worker.active = false; // Submit now places tasks elsewhere
+                return true;
+            }
+        }
+        return false;
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Factory::Concurrency {
+
+    inline constexpr size_t MAX_POOL_WORKERS = 64;
+    inline constexpr size_t NO_WORKER = static_cast<size_t>(-1);
+
+    // Queued tasks per running worker above which the pool starts another worker
+    inline constexpr size_t POOL_GROW_THRESHOLD = 4;
+
+    // Wall-clock time (milliseconds) a worker above the minimum may idle before it retires
+    inline constexpr int POOL_IDLE_RETIRE_MS = 500;
+
+    /**
+     * Work-stealing thread pool.
+     * Every worker owns a deque: it runs its own tasks newest first, and an idle worker
+     * steals the oldest task of a randomly chosen victim. Tasks submitted from a worker
+     * stay on that worker unless a hint names another one, so related work keeps running
+     * where its state is warm.
+     *
+     * A worker with nothing to run or steal asks the `Source` for new work (the Controller
+     * hands out queued jobs this way, keeping its own admission order). The number of
+     * workers floats between a minimum and a maximum: the pool grows while the backlog per
+     * worker exceeds POOL_GROW_THRESHOLD, and workers above the minimum retire after
+     * POOL_IDLE_RETIRE_MS without work.
+     */
+    class WorkStealingPool {
+    public:
+        using Task = std::function<void()>;
+        // Returns the next task from outside the pool, or an empty task if there is none
+        using Source = std::function<Task()>;
+
+        WorkStealingPool() = default;
+        ~WorkStealingPool() { Stop(); }
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        /** Starts `minWorkers` workers; up to `maxWorkers` run while there is a backlog.
+         *
+         * @throws std::invalid_argument unless 0 < minWorkers <= maxWorkers <= MAX_POOL_WORKERS
+         * @throws std::logic_error if the pool is already running
+         * @throws std::system_error if a thread cannot be started
+         * Exception guarantee: basic (workers started before a failure keep running)
+         */
+        void Start(size_t minWorkers, size_t maxWorkers, Source source = {});
+
+        /** Runs every task still queued in the pool, then joins all workers. The source is
+         * no longer consulted once stopping.
+         *
+         * Exception guarantee: no-throw
+         */
+        void Stop() noexcept;
+
+        /** Queues a task on worker `hint`, or, without a hint, on the calling worker. Tasks
+         * submitted from other threads, or for a worker that has retired, are spread
+         * round-robin. Before Start, tasks are held for the first worker.
+         *
+         * @throws std::bad_alloc
+         * Exception guarantee: strong
+         */
+        void Submit(Task task, size_t hint = NO_WORKER);
+
+        /** Announces new work at the source; `backlog` is its current size and counts
+         * towards growing the pool.
+         *
+         * Exception guarantee: no-throw
+         */
+        void Notify(size_t backlog = 0) noexcept;
+
+        // Index of the calling worker of this pool, or NO_WORKER on any other thread
+        size_t CurrentWorker() const noexcept;
+
+        size_t WorkerCount() const noexcept { return activeCount_.load(std::memory_order_relaxed); }
+
+    private:
+        struct alignas(64) Worker {
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::deque<Task> tasks;
+            std::atomic<size_t> size{0};
+            bool active{false};   // guarded by mutex
+            bool sleeping{false}; // guarded by mutex
+            std::thread thread;
+        };
+
+        void Run(size_t index);
+        Task PopLocal(Worker& worker);
+        Task Steal(size_t thief);
+        // Wakes one sleeping worker so it can steal or fetch from the source
+        void WakeIdle() noexcept;
+        void MaybeGrow(size_t backlog) noexcept;
+        void StartWorker(size_t index); // caller holds lifecycleMutex_
+        // Called with the worker's lock held and its deque empty
+        bool TryRetire(Worker& worker) noexcept;
+
+        std::array<Worker, MAX_POOL_WORKERS> workers_;
+        std::atomic<size_t> activeCount_{0};
+        std::atomic<size_t> highWater_{0}; // slots ever started, bounds the steal scan
+        std::atomic<size_t> queued_{0};    // tasks in all deques
+        std::atomic<size_t> idle_{0};      // workers sleeping on their condition variable
+        std::atomic<size_t> cursor_{0};    // round-robin placement
+        std::atomic<std::uint64_t> epoch_{0}; // bumped whenever idle workers should look again
+        std::atomic_bool running_{false};
+        std::atomic_bool stop_{false};
+        size_t minWorkers_{0};
+        size_t maxWorkers_{0};
+        Source source_;
+        std::mutex lifecycleMutex_; // serializes Start, Stop and growth
+    };
+}
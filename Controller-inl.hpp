@@ -0,0 +1,280 @@
+#pragma once
+
+// Typed pipeline execution: template members of Controller, included at the end of Controller.hpp
+
+#include "Controller.hpp"
+
+namespace Factory {
+
+    template<class... Stages>
+    void Controller::Launch(std::string name, const Pipeline<Stages...>& pipeline,
+                            std::function<void(bool succeeded)> onDone) {
+        using Execution = PipelineExecution<Stages...>;
+        auto execution = std::make_shared<Execution>(std::move(name), pipeline.stages(), clock_->Now(),
+                                                     std::move(onDone));
+        std::apply([&](const auto&... stage) {
+            ([&] {
+                using Stage = std::decay_t<decltype(stage)>;
+                if constexpr (Pipelines::is_move_stage_v<Stage>) {
+                    if (static_cast<const Machinery::MachineBase*>(stage.source) == resourceStation_) {
+                        execution->demand[static_cast<size_t>(Stage::Material::kind)] += static_cast<long>(stage.count);
+                    }
+                }
+            }(), ...);
+        }, execution->stages);
+
+        const auto demand = execution->demand;
+        auto withdrawDemand = [this, &demand] {
+            for (size_t kind = 0; kind < demand.size(); ++kind) {
+                demand_[kind].fetch_sub(demand[kind]);
+            }
+        };
+        for (size_t kind = 0; kind < demand.size(); ++kind) {
+            demand_[kind].fetch_add(demand[kind]);
+        }
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            ++inFlightJobs_;
+        }
+        FACTORY_TRACE(AsyncBegin, "job", execution->name, execution->name, execution->submittedAt,
+                      {{"kind", "pipeline"}});
+        FACTORY_LOG_INFO("[CONTROLLER] job: ", execution->name, " launched as pipeline of ",
+                         Pipeline<Stages...>::STAGE_COUNT, " stages");
+        try {
+            Post([this, execution] {
+                execution->worker = workers_.CurrentWorker(); // keep the pipeline's continuations on this worker
+                StartStage<0>(execution);
+            });
+        } catch (...) {
+            withdrawDemand();
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            --inFlightJobs_;
+            throw;
+        }
+        // Generation catches up on its next round if this fails, so the launch still stands
+        for (size_t kind = 0; kind < demand.size(); ++kind) {
+            if (demand[kind] > 0) {
+                try {
+                    Replenish(static_cast<Data::MaterialKind>(kind));
+                } catch (const std::exception& e) {
+                    FACTORY_LOG_ERROR("[CONTROLLER] Failed to replenish ",
+                                      Data::toString(static_cast<Data::MaterialKind>(kind)), " with error: ", e.what());
+                }
+            }
+        }
+    }
+
+    template<size_t I, class Execution>
+    void Controller::StartStage(const std::shared_ptr<Execution>& execution) {
+        if constexpr (I == std::tuple_size_v<decltype(execution->stages)>) {
+            FinishPipeline(execution, nullptr);
+        } else {
+            const auto& stage = std::get<I>(execution->stages);
+            const size_t items = Pipelines::itemsOf(stage);
+            {
+                std::lock_guard<std::mutex> lock(execution->mutex);
+                if (execution->finished) {
+                    return;
+                }
+                execution->stage = I;
+                execution->pending = items;
+            }
+            FACTORY_LOG_INFO("[CONTROLLER] job: ", execution->name, " executing stage number ", I + 1);
+            FACTORY_TRACE(AsyncBegin, "step", "stage " + std::to_string(I + 1),
+                          execution->name + "/" + std::to_string(I + 1),
+                          {{"job", execution->name}, {"step", Pipelines::describeStage(stage)}});
+            std::vector<PipelineItemPtr> started;
+            started.reserve(items);
+            for (size_t i = 0; i < items; ++i) {
+                started.push_back(std::make_shared<PipelineItem>());
+            }
+            DispatchStageItems<I>(execution, started);
+        }
+    }
+
+    template<size_t I, class Execution>
+    void Controller::DispatchStageItems(const std::shared_ptr<Execution>& execution,
+                                        const std::vector<PipelineItemPtr>& items) {
+        {
+            std::lock_guard<std::mutex> lock(execution->mutex);
+            if (execution->finished) {
+                return; // another item failed the pipeline while these were parked
+            }
+        }
+        const auto& stage = std::get<I>(execution->stages);
+        using Stage = std::decay_t<decltype(stage)>;
+        auto done = [this, execution](const PipelineItemPtr& item) -> Machinery::Completion {
+            return [this, execution, item](StepStatus status) {
+                Post([this, execution, item, status] { OnStageItemCompleted<I>(execution, item, status); },
+                     execution->worker);
+            };
+        };
+        try {
+            if constexpr (Pipelines::is_move_stage_v<Stage>) {
+                std::vector<Machinery::TransportCommand> loads;
+                loads.reserve(items.size());
+                for (const auto& item : items) {
+                    loads.push_back(Machinery::TransportCommand{
+                        Stage::Material::kind, *stage.source, *stage.destination, done(item)});
+                }
+                DispatchTransports(*stage.source, std::move(loads));
+            } else {
+                for (const auto& item : items) {
+                    if (observersEnabled_.load(std::memory_order_relaxed)) {
+                        onProcessDispatched(Stage::Material::kind, *stage.machine);
+                    }
+                    stage.machine->EnqueueProcess(
+                        Machinery::ProcessCommand{Stage::Material::kind, done(item), stage.maxItems});
+                }
+            }
+        } catch (const std::exception& e) {
+            FACTORY_LOG_ERROR("[CONTROLLER] job: ", execution->name, " failed to dispatch stage number ", I + 1,
+                              " with error: ", e.what());
+            FinishPipeline(execution, "Job execution failed due to dispatch error");
+        }
+    }
+
+    template<size_t I, class Execution>
+    void Controller::OnStageItemCompleted(const std::shared_ptr<Execution>& execution, const PipelineItemPtr& item,
+                                          StepStatus status) {
+        using Stage = std::tuple_element_t<I, decltype(execution->stages)>;
+        switch (status) {
+            case SUCCESS: {
+                bool stageDone;
+                bool fromStation = false;
+                {
+                    std::lock_guard<std::mutex> lock(execution->mutex);
+                    if (execution->finished) {
+                        return; // late completion of an item whose pipeline already failed
+                    }
+                    if constexpr (Pipelines::is_move_stage_v<Stage>) {
+                        const auto* source = std::get<I>(execution->stages).source;
+                        fromStation = static_cast<const Machinery::MachineBase*>(source) == resourceStation_;
+                        if (fromStation) {
+                            --execution->demand[static_cast<size_t>(Stage::Material::kind)];
+                        }
+                    }
+                    stageDone = --execution->pending == 0;
+                }
+                if (fromStation) {
+                    demand_[static_cast<size_t>(Stage::Material::kind)].fetch_sub(1);
+                }
+                if (stageDone) {
+                    FACTORY_LOG_INFO("[CONTROLLER] job: ", execution->name, " stage number ", I + 1,
+                                     " completed successfully");
+                    FACTORY_TRACE(AsyncEnd, "step", "stage " + std::to_string(I + 1),
+                                  execution->name + "/" + std::to_string(I + 1), {{"status", "success"}});
+                    StartStage<I + 1>(execution);
+                }
+                break;
+            }
+            case RETRY:
+            case BLOCKED:
+                ParkStageItem<I>(execution, item, status);
+                break;
+            case ERROR:
+                FinishPipeline(execution, "Job execution failed due to critical error");
+                break;
+        }
+    }
+
+    template<size_t I, class Execution>
+    void Controller::ParkStageItem(const std::shared_ptr<Execution>& execution, const PipelineItemPtr& item,
+                                   StepStatus reason) {
+        // Same waits as ParkStep: RETRY for material at the source or processor, BLOCKED for
+        // room at the destination or for the processor's output
+        const auto& stage = std::get<I>(execution->stages);
+        using Stage = std::decay_t<decltype(stage)>;
+        const bool forSpace = reason == BLOCKED;
+        Machinery::MachineBase* machine;
+        Data::MaterialKind kind;
+        if constexpr (Pipelines::is_move_stage_v<Stage>) {
+            machine = forSpace ? static_cast<Machinery::MachineBase*>(stage.destination)
+                               : static_cast<Machinery::MachineBase*>(stage.source);
+            kind = Stage::Material::kind;
+        } else {
+            machine = stage.machine;
+            kind = forSpace ? Pipelines::productKindOf<Stage>() : Stage::Material::kind;
+        }
+        const char* timedOut = forSpace ? "Job execution failed due to timing out waiting for space"
+                                        : "Job execution failed due to timing out waiting for material";
+        FACTORY_TRACE(Instant, "step", forSpace ? "park for space" : "park for material",
+                      {{"job", execution->name}, {"step", std::to_string(I + 1)},
+                       {"machine", std::string(machine->Name())}});
+
+        // An item's continuations run one after another, so its state needs no lock
+        const auto now = clock_->Now();
+        if (!item->waitDeadline) {
+            item->waitDeadline = now + GetMaterialWaitTimeout();
+        }
+        const auto remaining = *item->waitDeadline - now;
+        if (remaining <= Clock::Duration::zero()) {
+            FinishPipeline(execution, timedOut);
+            return;
+        }
+
+        auto resume = [this, execution, item] { DispatchStageItems<I>(execution, {item}); };
+        bool parked;
+        try {
+            parked = kind != Data::MaterialKind::Invalid
+                     && Park(*machine, kind, forSpace, remaining, execution->worker, resume,
+                             [this, execution, timedOut] { FinishPipeline(execution, timedOut); });
+        } catch (const std::exception& e) {
+            FACTORY_LOG_ERROR("[CONTROLLER] job: ", execution->name, " failed to wait for ",
+                              forSpace ? "space" : "material", " with error: ", e.what());
+            FinishPipeline(execution, "Job execution failed due to critical error");
+            return;
+        }
+        if (parked) {
+            return;
+        }
+
+        // No notifications from this machine: back off like RetryAfterDelay
+        if (++item->retries > MAX_STEP_RETRIES) {
+            FinishPipeline(execution, "Job execution failed due to exceeding max retries");
+            return;
+        }
+        FACTORY_TRACE(Instant, "step", "retry", {{"job", execution->name}, {"step", std::to_string(I + 1)},
+                                                 {"attempt", std::to_string(item->retries)}});
+        timers_.ScheduleAfter(std::chrono::milliseconds(RETRY_DELAY_MS), [this, execution, resume] {
+            Post(resume, execution->worker);
+        });
+    }
+
+    template<class Execution>
+    void Controller::FinishPipeline(const std::shared_ptr<Execution>& execution, const char* failure) noexcept {
+        size_t stage;
+        {
+            std::lock_guard<std::mutex> lock(execution->mutex);
+            if (execution->finished) {
+                return; // items running in parallel may fail the pipeline more than once
+            }
+            execution->finished = true;
+            stage = execution->stage;
+            for (size_t kind = 0; kind < execution->demand.size(); ++kind) {
+                if (execution->demand[kind] > 0) {
+                    demand_[kind].fetch_sub(execution->demand[kind]);
+                    execution->demand[kind] = 0;
+                }
+            }
+        }
+        if (failure != nullptr) {
+            try {
+                FACTORY_TRACE(AsyncEnd, "step", "stage " + std::to_string(stage + 1),
+                              execution->name + "/" + std::to_string(stage + 1), {{"status", failure}});
+            } catch (...) {
+                // Tracing must never fail a job
+            }
+        }
+        if (execution->onDone) {
+            try {
+                execution->onDone(failure == nullptr);
+            } catch (const std::exception& e) {
+                FACTORY_LOG_ERROR("[CONTROLLER] job: ", execution->name, " completion callback threw: ", e.what());
+            } catch (...) {
+                FACTORY_LOG_ERROR("[CONTROLLER] job: ", execution->name, " completion callback threw");
+            }
+        }
+        FinishJob(execution->name, failure, execution->submittedAt); // last: the controller may stop after this
+    }
+}
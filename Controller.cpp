@@ -1,159 +1,556 @@
 #include "Controller.hpp"
 #include "Machines/Cutter.hpp"
 
+#include <algorithm>
 #include <array>
 #include <functional>
-#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <utility>
 
 namespace Factory {
 
-    void Controller::ConnectMoverSignal(Machinery::Mover* mover) {
-        using namespace std::placeholders;
-
-        // Use std::bind to create a callable that captures the target mover
-        // and forwards the signal arguments to HandleTransport
-        onTransportRequested.connect(
-            std::bind(
-                &Controller::HandleTransport,
-                this,
-                mover,      // targetMover - bound at connection time
-                _1,         // requestedMover - from signal
-                _2,         // material_kind - from signal
-                _3,         // source - from signal
-                _4,         // destination - from signal
-                _5          // cmdCompleted - from signal
-            )
-        );
-
-        std::cout << "[CONTROLLER] Connected transport signal for mover: "
-                  << mover->Name() << std::endl;
-    }
-
-    void Controller::ConnectProducerSignal(Machinery::MachineBase* producer) {
-        using namespace std::placeholders;
-
-        // Use std::bind to create a callable that captures the target producer
-        // and forwards the signal arguments to HandleProcess
-        onProcessRequested.connect(
-            std::bind(
-                &Controller::HandleProcess,
-                this,
-                producer,   // targetProducer - bound at connection time
-                _1,         // material_kind - from signal
-                _2,         // requestedTarget - from signal
-                _3          // cmdCompleted - from signal
-            )
-        );
-
-        std::cout << "[CONTROLLER] Connected process signal for producer: "
-                  << producer->Name() << std::endl;
-    }
-
-    void Controller::HandleTransport(
-        Machinery::Mover* targetMover,
-        Machinery::Mover* requestedMover,
-        Data::MaterialKind kind,
-        Machinery::MachineBase& source,
-        Machinery::MachineBase& destination,
-        std::promise<StepStatus>& cmdCompleted)
-    {
-        // Only handle if this is the mover we're bound to
-        if (requestedMover != targetMover) {
-            return;
+    namespace {
+        std::string WorkerArg(size_t worker) {
+            return worker == Concurrency::NO_WORKER ? "-" : std::to_string(worker);
+        }
+
+        std::string StepTraceId(const std::string& jobName, StepId id) {
+            return jobName + "/" + std::to_string(id + 1);
         }
 
-        Machinery::TransportCommand command{kind, source, destination, cmdCompleted};
-        targetMover->EnqueueCommand(std::move(command));
+        using StockKey = std::pair<Machinery::MachineId, Data::MaterialKind>;
+
+        // Input items the resumed jobs will process at each machine beyond what their own
+        // pending moves deliver there. Input stock above that has no job left to use it.
+        std::map<StockKey, std::uint64_t> InputClaims(const std::vector<Persistence::RecoveredJob>& jobs) {
+            std::map<StockKey, long> balance;
+            for (const auto& entry : jobs) {
+                for (StepId id = 0; id < entry.job.steps.size(); ++id) {
+                    if (std::find(entry.completed.begin(), entry.completed.end(), id) != entry.completed.end()) {
+                        continue;
+                    }
+                    const auto& step = entry.job.steps[id];
+                    if (step.move) {
+                        --balance[{step.destination, step.material}];
+                    } else {
+                        balance[{step.machine, step.material}] += static_cast<long>(std::max<std::uint64_t>(step.maxItems, 1));
+                    }
+                }
+            }
+            std::map<StockKey, std::uint64_t> claims;
+            for (const auto& [key, items] : balance) {
+                if (items > 0) {
+                    claims[key] = static_cast<std::uint64_t>(items);
+                }
+            }
+            return claims;
+        }
     }
 
-    void Controller::HandleProcess(
-        Machinery::MachineBase* targetProducer,
-        Data::MaterialKind kind,
-        Machinery::MachineBase& requestedTarget,
-        std::promise<StepStatus>& cmdCompleted)
-    {
-        // Only handle if this is the producer we're bound to
-        if (&requestedTarget != targetProducer) {
-            return;
+    void Controller::RegisterRoute(Machinery::MachineBase* machine, RouteRole role) {
+        std::lock_guard<std::mutex> lock(routesMutex_);
+        const size_t id = routeCount_.load(std::memory_order_relaxed);
+        if (id >= MAX_MACHINES) {
+            throw std::length_error("[CONTROLLER] routing table is full");
         }
+        routes_[id] = Route{machine, role};
+        machine->SetId(static_cast<Machinery::MachineId>(id));
+        routeCount_.store(id + 1, std::memory_order_release);
 
-        Machinery::ProcessCommand command{kind, cmdCompleted};
-        targetProducer->EnqueueCommand(std::move(command));
+        FACTORY_LOG_INFO("[CONTROLLER] Registered machine: ", machine->Name(), " with id ", id);
     }
 
+    Machinery::MachineBase& Controller::Resolve(const Machinery::MachineBase& machine, RouteRole role) const {
+        const auto id = machine.Id();
+        if (id >= routeCount_.load(std::memory_order_acquire) || routes_[id].machine != &machine) {
+            throw std::invalid_argument("[CONTROLLER] machine " + std::string(machine.Name())
+                                        + " is not registered with this controller");
+        }
+        if (routes_[id].role != role) {
+            throw std::invalid_argument("[CONTROLLER] machine " + std::string(machine.Name())
+                                        + " cannot execute this kind of step");
+        }
+        return *routes_[id].machine;
+    }
 
+    void Controller::RegisterMover(Machinery::Mover* mover) noexcept {
+        std::lock_guard<std::mutex> lock(routesMutex_);
+        const size_t index = moverCount_.load(std::memory_order_relaxed);
+        movers_[index] = mover; // bounded by the routing table, which holds every mover
+        moverCount_.store(index + 1, std::memory_order_release);
+    }
+
+    Machinery::Mover& Controller::PickMover(const Machinery::MachineBase& source, size_t items) {
+        const size_t count = moverCount_.load(std::memory_order_acquire);
+        if (count == 0) {
+            throw std::invalid_argument("[CONTROLLER] no mover registered for pool dispatch");
+        }
+        const size_t start = moverCursor_.fetch_add(1, std::memory_order_relaxed) % count;
+        Machinery::Mover* best = nullptr;
+        Machinery::Mover* sharing = nullptr;
+        Machinery::Mover* idle = nullptr;
+        size_t bestDepth = 0;
+        double idleDistance = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < count; ++i) {
+            auto* candidate = movers_[(start + i) % count];
+            const size_t depth = candidate->QueueDepth();
+            if (depth == 0) {
+                // Closest idle mover: the shortest empty run to the source
+                const double distance = candidate->DistanceTo(source).value_or(std::numeric_limits<double>::infinity());
+                if (idle == nullptr || distance < idleDistance) {
+                    idle = candidate;
+                    idleDistance = distance;
+                }
+                continue;
+            }
+            if (sharing == nullptr && candidate->HasOpenTrip(source, std::min(items, candidate->Capacity()))) {
+                sharing = candidate;
+            }
+            if (best == nullptr || depth < bestDepth) {
+                best = candidate;
+                bestDepth = depth;
+            }
+        }
+        if (idle != nullptr) {
+            return *idle;
+        }
+        // Every mover is busy: riding along on a queued trip costs no extra trip
+        return sharing != nullptr ? *sharing : *best;
+    }
+
+    void Controller::DispatchTransports(Machinery::MachineBase& source,
+                                        std::vector<Machinery::TransportCommand> loads) {
+        for (size_t next = 0; next < loads.size();) {
+            auto& mover = PickMover(source, loads.size() - next);
+            const size_t end = next + std::min(mover.Capacity(), loads.size() - next);
+            std::vector<Machinery::TransportCommand> trip;
+            trip.reserve(end - next);
+            for (; next < end; ++next) {
+                if (observersEnabled_.load(std::memory_order_relaxed)) {
+                    onTransportDispatched(mover, loads[next].material_kind, source, loads[next].destination);
+                }
+                trip.push_back(std::move(loads[next]));
+            }
+            mover.EnqueueTrip(std::move(trip));
+        }
+    }
 
     void Controller::executeJob(Job job) {
-        int stepCounter = 1;
+        job.setSubmittedAt(clock_->Now());
+        JournalJob(job);
+        for (StepId id = 0; id < job.stepCount(); ++id) {
+            if (!job.completed(id)) {
+                AdjustDemand(job.step(id), +1);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            ++inFlightJobs_;
+        }
+        StartJob(std::move(job));
+    }
+
+    void Controller::StartJob(Job job) {
+        auto execution = std::make_shared<JobExecution>(std::move(job));
+        execution->worker = workers_.CurrentWorker(); // keep the job's continuations on this worker
+        FACTORY_TRACE(AsyncBegin, "job", execution->job.name(), execution->job.name(), execution->job.submittedAt(),
+                      {{"priority", toString(execution->job.priority())}, {"worker", WorkerArg(execution->worker)}});
+        if (execution->remaining == 0) {
+            FinishJob(execution, nullptr);
+            return;
+        }
+        // Every step without dependencies left starts right away
+        std::vector<StepId> ready;
+        for (StepId id = 0; id < execution->steps.size(); ++id) {
+            if (execution->steps[id].pendingDependencies == 0 && !execution->steps[id].done) {
+                ready.push_back(id);
+            }
+        }
+        StartSteps(execution, ready);
+    }
+
+    void Controller::JournalJob(Job& job) {
+        if (!journal_ || job.journalId()) {
+            return;
+        }
+        const std::uint64_t id = journal_->NextJobId();
+        journal_->JobSubmitted(id, Persistence::recordJob(job, job.submittedAt()));
+        job.setJournalId(id);
+    }
+
+    void Controller::StartSteps(const ExecutionPtr& execution, const std::vector<StepId>& ready) {
+        std::vector<StepId> moves;
+        for (StepId id : ready) {
+            FACTORY_LOG_INFO("[CONTROLLER] job: ", execution->job.name(), " executing step number ", id + 1);
+            FACTORY_TRACE(AsyncBegin, "step", "step " + std::to_string(id + 1), StepTraceId(execution->job.name(), id),
+                          {{"job", execution->job.name()}, {"step", describeStep(execution->job.step(id))},
+                           {"worker", WorkerArg(workers_.CurrentWorker())}});
+            const auto* move = std::get_if<MoveStep>(&execution->job.step(id));
+            if (move != nullptr && !move->mover) {
+                moves.push_back(id);
+            } else {
+                DispatchStep(execution, id);
+            }
+        }
+        if (!moves.empty()) {
+            DispatchMoves(execution, std::move(moves));
+        }
+    }
+
+    void Controller::DispatchMoves(const ExecutionPtr& execution, std::vector<StepId> moves) {
+        {
+            std::lock_guard<std::mutex> lock(execution->mutex);
+            if (execution->finished) {
+                return;
+            }
+        }
+        auto sourceOf = [&execution](StepId id) {
+            return &std::get<MoveStep>(execution->job.step(id)).source.get();
+        };
+        try {
+            std::stable_sort(moves.begin(), moves.end(), [&sourceOf](StepId a, StepId b) {
+                return std::less<>{}(sourceOf(a), sourceOf(b));
+            });
+            for (size_t first = 0; first < moves.size();) {
+                auto* source = sourceOf(moves[first]);
+                std::vector<Machinery::TransportCommand> loads;
+                for (; first < moves.size() && sourceOf(moves[first]) == source; ++first) {
+                    const auto& s = std::get<MoveStep>(execution->job.step(moves[first]));
+                    loads.push_back(Machinery::TransportCommand{s.material, s.source.get(), s.destination.get(),
+                                                                StepCompletion(execution, moves[first])});
+                }
+                DispatchTransports(*source, std::move(loads));
+            }
+        } catch (const std::exception& e) {
+            FACTORY_LOG_ERROR("[CONTROLLER] job: ", execution->job.name(), " failed to dispatch its move steps",
+                              " with error: ", e.what());
+            FinishJob(execution, "Job execution failed due to dispatch error");
+        }
+    }
+
+    Machinery::Completion Controller::StepCompletion(const ExecutionPtr& execution, StepId id) {
+        return [this, execution, id](StepStatus status) {
+            Post([this, execution, id, status] { OnStepCompleted(execution, id, status); }, execution->worker);
+        };
+    }
+
+    void Controller::DispatchStep(const ExecutionPtr& execution, StepId id) {
+        {
+            std::lock_guard<std::mutex> lock(execution->mutex);
+            if (execution->finished) {
+                return; // another step failed the job while this one was parked
+            }
+        }
+        try {
+            executeJobStep(execution->job.step(id), StepCompletion(execution, id));
+        } catch (const std::exception& e) {
+            FACTORY_LOG_ERROR("[CONTROLLER] job: ", execution->job.name(), " failed to dispatch step number ",
+                              id + 1, " with error: ", e.what());
+            FinishJob(execution, "Job execution failed due to dispatch error");
+        }
+    }
+
+    void Controller::OnStepCompleted(const ExecutionPtr& execution, StepId id, StepStatus status) {
+        std::vector<StepId> ready;
+        bool jobDone = false;
+        {
+            std::lock_guard<std::mutex> lock(execution->mutex);
+            if (execution->finished) {
+                return; // late completion of a step whose job already failed
+            }
+            if (status == SUCCESS) {
+                auto& state = execution->steps[id];
+                state.done = true;
+                state.retries = 0;
+                state.waitDeadline.reset();
+                jobDone = --execution->remaining == 0;
+                for (StepId dependent : execution->job.dependents(id)) {
+                    if (--execution->steps[dependent].pendingDependencies == 0) {
+                        ready.push_back(dependent);
+                    }
+                }
+            }
+        }
+
+        switch (status) {
+            case SUCCESS:
+                FACTORY_LOG_INFO("[CONTROLLER] job: ", execution->job.name(), " step number ", id + 1,
+                                 " completed successfully");
+                // Journaled before its dependents start, so a resumed job never skips a step it did not finish
+                if (journal_ && execution->job.journalId()) {
+                    journal_->StepCompleted(*execution->job.journalId(), id);
+                }
+                AdjustDemand(execution->job.step(id), -1);
+                FACTORY_TRACE(AsyncEnd, "step", "step " + std::to_string(id + 1), StepTraceId(execution->job.name(), id),
+                              {{"status", "success"}});
+                if (jobDone) {
+                    FinishJob(execution, nullptr);
+                    return;
+                }
+                StartSteps(execution, ready);
+                break;
+            case RETRY:
+            case BLOCKED:
+                ParkStep(execution, id, status);
+                break;
+            case ERROR:
+                FinishJob(execution, "Job execution failed due to critical error");
+                break;
+        }
+    }
+
+    void Controller::Spawn(std::string name, JobCoroutine job) {
+        FACTORY_LOG_INFO("[CONTROLLER] job: ", name, " spawned as coroutine");
+        auto handle = job.Release();
+        handle.promise().controller = this;
+        handle.promise().name = name;
+        FACTORY_TRACE(AsyncBegin, "job", name, name, {{"kind", "coroutine"}});
+        handle.promise().onDone = [this, name = std::move(name), submittedAt = clock_->Now()](std::exception_ptr error) {
+            if (!error) {
+                FinishJob(name, nullptr, submittedAt);
+                return;
+            }
+            try {
+                std::rethrow_exception(error);
+            } catch (const std::exception& e) {
+                FinishJob(name, e.what(), submittedAt);
+            } catch (...) {
+                FinishJob(name, "Job execution failed due to unknown error", submittedAt);
+            }
+        };
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            ++inFlightJobs_;
+        }
+        try {
+            Post([handle] { handle.resume(); });
+        } catch (...) {
+            handle.destroy();
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            --inFlightJobs_;
+            throw;
+        }
+    }
+
+    void Controller::ParkStep(const ExecutionPtr& execution, StepId id, StepStatus reason) {
+        // RETRY waits for material at the move's source or the processing machine;
+        // BLOCKED waits for room at the move's destination or for the processor's output
+        const bool forSpace = reason == BLOCKED;
+        auto [machine, kind] = std::visit([forSpace](const auto& s) -> std::pair<Machinery::MachineBase*, Data::MaterialKind> {
+            using S = std::decay_t<decltype(s)>;
+            if constexpr (std::is_same_v<S, MoveStep>) {
+                return {forSpace ? &s.destination.get() : &s.source.get(), s.material};
+            } else {
+                return {&s.executor.get(), forSpace ? s.product : s.material};
+            }
+        }, execution->job.step(id));
+        const char* waitingFor = forSpace ? "space" : "material";
+        FACTORY_TRACE(Instant, "step", std::string("park for ") + waitingFor,
+                      {{"job", execution->job.name()}, {"step", std::to_string(id + 1)},
+                       {"machine", std::string(machine->Name())}, {"worker", WorkerArg(workers_.CurrentWorker())}});
+
+        const auto now = clock_->Now();
+        Clock::Duration remaining;
+        {
+            std::lock_guard<std::mutex> lock(execution->mutex);
+            auto& deadline = execution->steps[id].waitDeadline;
+            if (!deadline) {
+                deadline = now + GetMaterialWaitTimeout();
+            }
+            remaining = *deadline - now;
+        }
+        if (remaining <= Clock::Duration::zero()) {
+            FinishJob(execution, forSpace ? "Job execution failed due to timing out waiting for space"
+                                                      : "Job execution failed due to timing out waiting for material");
+            return;
+        }
 
-        while (!job.stepsEmpty()) {
-            std::cout << "[CONTROLLER] job: " << job.name()
-                      << " executing step number " << stepCounter
-                      <<  std::endl;
+        bool subscribed;
+        try {
+            if (kind == Data::MaterialKind::Invalid) {
+                subscribed = false; // process step without a declared product
+            } else {
+                subscribed = Park(*machine, kind, forSpace, remaining, execution->worker,
+                    [this, execution, id, waitingFor] {
+                        FACTORY_LOG_INFO("[CONTROLLER] job: ", execution->job.name(), " ", waitingFor,
+                                         " available, resuming step number ", id + 1);
+                        DispatchStep(execution, id);
+                    },
+                    [this, execution, forSpace] {
+                        FinishJob(execution, forSpace ? "Job execution failed due to timing out waiting for space"
+                                                      : "Job execution failed due to timing out waiting for material");
+                    });
+            }
+        } catch (const std::exception& e) {
+            FACTORY_LOG_ERROR("[CONTROLLER] job: ", execution->job.name(), " failed to wait for ", waitingFor,
+                              " with error: ", e.what());
+            FinishJob(execution, "Job execution failed due to critical error");
+            return;
+        }
+        if (!subscribed) {
+            RetryAfterDelay(execution, id);
+            return;
+        }
 
-            const auto& currentStep = job.getNextStep();
-            std::promise<StepStatus> promise;
-            auto future = promise.get_future();
+        FACTORY_LOG_INFO("[CONTROLLER] job: ", execution->job.name(), " step number ", id + 1,
+                         " waiting for ", waitingFor, " for ", Data::toString(kind), " at ", machine->Name());
+    }
 
-            executeJobStep(currentStep, promise);
-            future.wait();
+    bool Controller::Park(Machinery::MachineBase& machine, Data::MaterialKind kind, bool forSpace,
+                          Clock::Duration timeout, size_t worker, std::function<void()> resume,
+                          std::function<void()> expire) {
+        auto wait = std::make_shared<Machinery::MaterialWait>([this, worker, resume = std::move(resume)] {
+            Post(resume, worker);
+        });
+        if (!(forSpace ? machine.NotifyWhenSpace(kind, wait) : machine.NotifyWhenAvailable(kind, wait))) {
+            return false;
+        }
+        // Whichever of wake-up and deadline claims the wait first runs; the other is dropped
+        timers_.ScheduleAfter(timeout, [this, wait, worker, expire = std::move(expire)] {
+            if (wait->TryClaim()) {
+                Post(expire, worker);
+            }
+        });
+        return true;
+    }
 
-            StepStatus stepStatus = future.get();
+    void Controller::RetryAfterDelay(const ExecutionPtr& execution, StepId id) {
+        int attempt;
+        {
+            std::lock_guard<std::mutex> lock(execution->mutex);
+            attempt = ++execution->steps[id].retries;
+        }
+        if (attempt > MAX_STEP_RETRIES) {
+            FinishJob(execution, "Job execution failed due to exceeding max retries");
+            return;
+        }
+        FACTORY_TRACE(Instant, "step", "retry", {{"job", execution->job.name()}, {"step", std::to_string(id + 1)},
+                                                 {"attempt", std::to_string(attempt)}});
+        // Back off on the timer thread; no worker is held while waiting
+        timers_.ScheduleAfter(std::chrono::milliseconds(RETRY_DELAY_MS), [this, execution, id, attempt] {
+            Post([this, execution, id, attempt] {
+                FACTORY_LOG_INFO("[CONTROLLER] job: ", execution->job.name(), " retrying step number ",
+                                 id + 1, " retry attempt ", attempt);
+                DispatchStep(execution, id);
+            }, execution->worker);
+        });
+    }
+
+    void Controller::FinishJob(const std::string& jobName, const char* failure, Clock::TimePoint submittedAt) noexcept {
+        if (failure == nullptr) {
+            jobLatency_.Record(clock_->Now() - submittedAt);
+            jobsFinished_.Add();
+            FACTORY_LOG_INFO("[CONTROLLER] job: ", jobName, " finished");
+        } else {
+            jobsFailed_.Add();
+            FACTORY_LOG_ERROR("[CONTROLLER] job: ", jobName, " failed: ", failure);
+        }
+        FACTORY_TRACE(AsyncEnd, "job", jobName, jobName, {{"result", failure == nullptr ? "finished" : failure}});
+
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (--inFlightJobs_ == 0 && stopWorkers_.load()) {
+            queueCV_.notify_all(); // let StopWorkers finish draining
+        }
+    }
 
-            for (int retries = 0; stepStatus == RETRY && retries < 3; retries++) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-                std::cout << "[CONTROLLER] job: " << job.name()
-                      << " retrying step number " << stepCounter
-                      << " retry attempt " << (retries + 1)
-                      <<  std::endl;
-                promise = std::promise<StepStatus>();
-                future = promise.get_future();
-                executeJobStep(currentStep, promise);
-                future.wait();
-                stepStatus = future.get();
+    void Controller::FinishJob(const ExecutionPtr& execution, const char* failure) noexcept {
+        {
+            std::lock_guard<std::mutex> lock(execution->mutex);
+            if (execution->finished) {
+                return; // steps running in parallel may fail the job more than once
+            }
+            execution->finished = true;
+            WithdrawDemand(*execution);
+            if (failure != nullptr && Tracing::Tracer::Instance().Enabled()) {
+                TraceAbandonedSteps(*execution, failure);
             }
+        }
+        // A failed job is not resumed either; it would fail the same way again
+        if (journal_ && execution->job.journalId()) {
+            journal_->JobFinished(*execution->job.journalId());
+        }
+        FinishJob(execution->job.name(), failure, execution->job.submittedAt());
+    }
 
-            switch (stepStatus) {
-                case SUCCESS:
-                    std::cout << "[CONTROLLER] job: " << job.name()
-                      << " step number " << stepCounter
-                      << " completed successfully" << std::endl;
-                    job.popStep();
-                    stepCounter++;
-                    break;
-                case RETRY:
-                    throw std::runtime_error("Job execution failed due to exceeding max retries");
-                case ERROR:
-                    throw std::runtime_error("Job execution failed due to critical error");
+    void Controller::TraceAbandonedSteps(const JobExecution& execution, const char* failure) noexcept {
+        try {
+            const auto jobName = execution.job.name();
+            for (StepId id = 0; id < execution.steps.size(); ++id) {
+                const auto& state = execution.steps[id];
+                if (state.pendingDependencies == 0 && !state.done) {
+                    Tracing::Tracer::Instance().AsyncEnd("step", "step " + std::to_string(id + 1),
+                                                         StepTraceId(jobName, id), {{"status", failure}});
+                }
             }
+        } catch (...) {
+            // Tracing must never fail a job
         }
     }
 
-    void Controller::executeJobStep(const JobStep& step, std::promise<StepStatus>& promise) {
-        std::visit([this, &promise](const auto& s) {
+    Metrics::FactoryMetrics Controller::CollectMetrics() const {
+        Metrics::FactoryMetrics metrics;
+        const size_t count = routeCount_.load(std::memory_order_acquire);
+        metrics.machines.reserve(count);
+        for (size_t id = 0; id < count; ++id) {
+            metrics.machines.push_back(routes_[id].machine->GetMetrics());
+        }
+        metrics.jobLatency = jobLatency_.Snapshot();
+        metrics.jobsFinished = jobsFinished_.Value();
+        metrics.jobsFailed = jobsFailed_.Value();
+        metrics.workers = workers_.WorkerCount();
+        return metrics;
+    }
+
+    void Controller::Post(std::function<void()> task, size_t worker) {
+        workers_.Submit(std::move(task), worker);
+    }
+
+    void Controller::executeJobStep(const JobStep& step, Machinery::Completion onCompleted) {
+        std::visit([this, &onCompleted](const auto& s) {
             using S = std::decay_t<decltype(s)>;
             if constexpr (std::is_same_v<S, MoveStep>) {
-                onTransportRequested(&s.mover.get(), s.material, s.source.get(), s.destination.get(), promise);
+                Machinery::TransportCommand load{s.material, s.source.get(), s.destination.get(), std::move(onCompleted)};
+                if (!s.mover) {
+                    std::vector<Machinery::TransportCommand> loads;
+                    loads.push_back(std::move(load));
+                    DispatchTransports(s.source.get(), std::move(loads));
+                    return;
+                }
+                auto& mover = s.mover->get();
+                Resolve(mover, RouteRole::Mover);
+                if (observersEnabled_.load(std::memory_order_relaxed)) {
+                    onTransportDispatched(mover, s.material, s.source.get(), s.destination.get());
+                }
+                mover.EnqueueCommand(std::move(load));
             } else if constexpr (std::is_same_v<S, ProcessStep>) {
-                onProcessRequested(s.material, s.executor.get(), promise);
+                auto& producer = Resolve(s.executor.get(), RouteRole::Producer);
+                if (observersEnabled_.load(std::memory_order_relaxed)) {
+                    onProcessDispatched(s.material, s.executor.get());
+                }
+                producer.EnqueueCommand(Machinery::ProcessCommand{s.material, std::move(onCompleted), s.maxItems});
             }
         }, step);
     }
 
-    void Controller::StartResourceGeneration() {
+    void Controller::StartResourceGeneration(GenerationMode mode) {
         if (!resourceStation_) {
-            std::cerr << "[CONTROLLER] Cannot start resource generation: no ResourceStation registered" << std::endl;
+            FACTORY_LOG_ERROR("[CONTROLLER] Cannot start resource generation: no ResourceStation registered");
             return;
         }
         
         if (generationRunning_.exchange(true)) {
-            std::cout << "[CONTROLLER] Resource generation already running" << std::endl;
+            FACTORY_LOG_INFO("[CONTROLLER] Resource generation already running");
             return;
         }
         
         stopGeneration_.store(false);
+        generationMode_.store(mode);
         resourceGenThread_ = std::thread(&Controller::ResourceGenerationLoop, this);
-        std::cout << "[CONTROLLER] Started resource generation thread" << std::endl;
+        FACTORY_LOG_INFO("[CONTROLLER] Started resource generation thread");
     }
 
     void Controller::StopResourceGeneration() noexcept {
@@ -165,130 +562,236 @@ namespace Factory {
         if (resourceGenThread_.joinable()) {
             try {
                 resourceGenThread_.join();
-                std::cout << "[CONTROLLER] Stopped resource generation thread" << std::endl;
+                FACTORY_LOG_INFO("[CONTROLLER] Stopped resource generation thread");
             } catch (...) {
-                std::cerr << "[ERROR] Failed to join resource generation thread" << std::endl;
+                FACTORY_LOG_ERROR("[ERROR] Failed to join resource generation thread");
             }
         }
     }
 
     void Controller::ResourceGenerationLoop() {
         // Material types to generate in rotation
-        constexpr std::array<Data::MaterialKind, 3> materials = {
-            Data::MaterialKind::MetalPipe,
-            Data::MaterialKind::Gravel,
-            Data::MaterialKind::TitaniumSlab
-        };
+        constexpr auto& materials = RAW_MATERIAL_KINDS;
         
         size_t materialIndex = 0;
         
         while (!stopGeneration_.load()) {
-            // Enqueue generation command for current material
-            Machinery::GenerateResourceCommand cmd{materials[materialIndex]};
-            resourceStation_->EnqueueCommand(cmd);
+            if (generationMode_.load() == GenerationMode::DemandDriven) {
+                // Demand increases replenish immediately; this only catches up on anything missed
+                for (auto kind : materials) {
+                    try {
+                        Replenish(kind);
+                    } catch (const std::exception& e) {
+                        FACTORY_LOG_ERROR("[CONTROLLER] Failed to replenish ", Data::toString(kind), " with error: ", e.what());
+                    }
+                }
+                clock_->SleepFor(std::chrono::milliseconds(GENERATION_INTERVAL_MS));
+                continue;
+            }
+
+            // Enqueue generation command for current material, unless its stock is throttled
+            if (resourceStation_->AcceptsGeneration(materials[materialIndex])) {
+                Machinery::GenerateResourceCommand cmd{materials[materialIndex]};
+                resourceStation_->EnqueueCommand(std::move(cmd));
+            }
             
             // Rotate to next material
             materialIndex = (materialIndex + 1) % materials.size();
             
             // Wait for the configured interval
-            std::this_thread::sleep_for(std::chrono::milliseconds(GENERATION_INTERVAL_MS));
+            clock_->SleepFor(std::chrono::milliseconds(GENERATION_INTERVAL_MS));
         }
     }
 
-    // ==================== Job Queue ====================
-
-    void Controller::EnqueueJob(Job job) {
-        {
-            std::lock_guard<std::mutex> lock(queueMutex_);
-            jobQueue_.push(std::move(job));
-            std::cout << "[CONTROLLER] Job enqueued. Queue size: " << jobQueue_.size() << std::endl;
+    void Controller::AdjustDemand(const JobStep& step, long delta) {
+        const auto* move = std::get_if<MoveStep>(&step);
+        if (move == nullptr || resourceStation_ == nullptr || &move->source.get() != resourceStation_) {
+            return;
+        }
+        demand_[static_cast<size_t>(move->material)].fetch_add(delta);
+        if (delta > 0) {
+            Replenish(move->material);
         }
-        queueCV_.notify_one();
     }
 
-    // ==================== Worker Pool ====================
+    void Controller::WithdrawDemand(const JobExecution& execution) noexcept {
+        for (StepId id = 0; id < execution.steps.size(); ++id) {
+            if (execution.steps[id].done) {
+                continue;
+            }
+            const auto* move = std::get_if<MoveStep>(&execution.job.step(id));
+            if (move != nullptr && resourceStation_ != nullptr && &move->source.get() == resourceStation_) {
+                demand_[static_cast<size_t>(move->material)].fetch_sub(1);
+            }
+        }
+    }
 
-    void Controller::StartWorkers(size_t workerCount) {
-        if (workersRunning_.exchange(true)) {
-            std::cout << "[CONTROLLER] Workers already running" << std::endl;
+    void Controller::Replenish(Data::MaterialKind kind) {
+        if (generationMode_.load() != GenerationMode::DemandDriven || !generationRunning_.load()) {
             return;
         }
+        const size_t index = static_cast<size_t>(kind);
+
+        std::lock_guard<std::mutex> lock(generationMutex_);
+        const long demand = demand_[index].load();
+        const long target = demand > 0 ? demand + static_cast<long>(safetyStock_[index].load()) : 0;
+        long supply = static_cast<long>(resourceStation_->Stock(kind)) + pendingGeneration_[index].load();
+        for (; supply < target && resourceStation_->AcceptsGeneration(kind); ++supply) {
+            pendingGeneration_[index].fetch_add(1);
+            try {
+                resourceStation_->EnqueueCommand(Machinery::GenerateResourceCommand{kind, [this, index](StepStatus) {
+                    pendingGeneration_[index].fetch_sub(1);
+                }});
+            } catch (...) {
+                pendingGeneration_[index].fetch_sub(1);
+                throw;
+            }
+        }
+    }
 
-        stopWorkers_.store(false);
-        workers_.reserve(workerCount);
+    // ==================== Job Queue ====================
 
-        for (size_t i = 0; i < workerCount; ++i) {
-            workers_.emplace_back(&Controller::WorkerLoop, this, i);
+    void Controller::EnqueueJob(Job job) {
+        job.setSubmittedAt(clock_->Now());
+        JournalJob(job);
+        for (StepId id = 0; id < job.stepCount(); ++id) {
+            if (!job.completed(id)) {
+                AdjustDemand(job.step(id), +1);
+            }
         }
-
-        std::cout << "[CONTROLLER] Started " << workerCount << " worker threads" << std::endl;
+        size_t backlog;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            jobQueue_.Push(std::move(job), clock_->Now());
+            backlog = jobQueue_.Size();
+            FACTORY_LOG_INFO("[CONTROLLER] Job enqueued. Queue size: ", backlog);
+        }
+        workers_.Notify(backlog);
     }
 
-    void Controller::StopWorkers() noexcept {
-        if (!workersRunning_.exchange(false)) {
-            return;
+    size_t Controller::EnableJournal(const std::filesystem::path& directory) {
+        if (journal_) {
+            throw std::logic_error("[CONTROLLER] a journal is enabled already");
         }
+        auto journal = std::make_unique<Persistence::Journal>(directory);
+        const auto& recovered = journal->Recovered();
+        const size_t machines = routeCount_.load(std::memory_order_acquire);
+        const Persistence::MachineResolver resolve = [this, machines](Machinery::MachineId id) {
+            return id < machines ? routes_[id].machine : nullptr;
+        };
 
-        stopWorkers_.store(true);
-        queueCV_.notify_all();  // Wake up all waiting workers
+        // Stock first, so resumed steps find their material. Steps re-run after a crash and
+        // coroutine jobs are not journaled, so a producer's input may hold items no resumed job
+        // processes; those are dropped, or they would fill its input for good.
+        const auto claims = InputClaims(recovered.jobs);
+        for (const auto& stock : recovered.stock) {
+            auto* machine = resolve(stock.machine);
+            if (machine == nullptr) {
+                FACTORY_LOG_ERROR("[CONTROLLER] journal names unknown machine ", stock.machine, "; dropping its ",
+                                  stock.count, " ", Data::toString(stock.kind));
+                continue;
+            }
+            std::uint64_t count = stock.count;
+            if (machine->CanAccept(stock.kind)) {
+                const auto claim = claims.find({stock.machine, stock.kind});
+                const std::uint64_t claimed = claim == claims.end() ? 0 : claim->second;
+                if (count > claimed) {
+                    FACTORY_LOG_INFO("[CONTROLLER] dropping ", count - claimed, " ", Data::toString(stock.kind), " at ",
+                                     machine->Name(), ": no resumed job processes them");
+                    journal->OnStockChanged(stock.machine, stock.kind, -static_cast<int>(count - claimed));
+                    count = claimed;
+                }
+            }
+            if (count == 0) {
+                continue;
+            }
+            try {
+                machine->Restock(stock.kind, count);
+            } catch (const std::exception& e) {
+                FACTORY_LOG_ERROR("[CONTROLLER] failed to restock ", machine->Name(), " with error: ", e.what());
+            }
+        }
+        journal_ = std::move(journal);
+        for (size_t id = 0; id < machines; ++id) {
+            routes_[id].machine->SetInventoryObserver(journal_.get());
+        }
 
-        for (auto& worker : workers_) {
-            if (worker.joinable()) {
-                try {
-                    worker.join();
-                } catch (...) {
-                    std::cerr << "[ERROR] Failed to join worker thread" << std::endl;
+        size_t resumed = 0;
+        for (const auto& entry : recovered.jobs) {
+            try {
+                Job job = Persistence::restoreJob(entry.job, resolve, clock_->Now());
+                for (StepId step : entry.completed) {
+                    job.markCompleted(step);
                 }
+                job.setJournalId(entry.id);
+                EnqueueJob(std::move(job));
+                ++resumed;
+            } catch (const std::exception& e) {
+                FACTORY_LOG_ERROR("[CONTROLLER] cannot resume job: ", entry.job.name, " with error: ", e.what());
+                journal_->JobFinished(entry.id); // not tried again on the next start
             }
         }
-        workers_.clear();
-        std::cout << "[CONTROLLER] Stopped all worker threads" << std::endl;
+        FACTORY_LOG_INFO("[CONTROLLER] Journal enabled in ", directory.string(), ": resumed ", resumed, " jobs, restocked ",
+                         recovered.stock.size(), " kinds from ", recovered.records, " records in ",
+                         std::chrono::duration_cast<std::chrono::microseconds>(recovered.replayTime).count(), "us");
+        return resumed;
     }
 
-    void Controller::WorkerLoop(size_t workerId) {
-        std::cout << "[WORKER " << workerId << "] Started" << std::endl;
+    std::function<void()> Controller::NextJob() {
+        std::optional<Job> job;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            if (jobQueue_.Empty()) {
+                return {};
+            }
+            job = jobQueue_.Pop(clock_->Now());
+            ++inFlightJobs_;
+        }
+        FACTORY_LOG_INFO("[WORKER ", workers_.CurrentWorker(), "] Picked up job: ", job->name());
+        return [this, job = std::move(*job)]() mutable { StartJob(std::move(job)); };
+    }
 
-        while (!stopWorkers_.load()) {
-            Job job("");
-            bool hasJob = false;
+    // ==================== Worker Pool ====================
 
-            {
-                std::unique_lock<std::mutex> lock(queueMutex_);
-                queueCV_.wait(lock, [this] {
-                    return stopWorkers_.load() || !jobQueue_.empty();
-                });
+    void Controller::StartWorkers(size_t minWorkers, size_t maxWorkers) {
+        if (workersRunning_.exchange(true)) {
+            FACTORY_LOG_INFO("[CONTROLLER] Workers already running");
+            return;
+        }
 
-                if (stopWorkers_.load() && jobQueue_.empty()) {
-                    break;
-                }
+        stopWorkers_.store(false);
+        try {
+            workers_.Start(minWorkers, std::max(minWorkers, maxWorkers), [this] { return NextJob(); });
+        } catch (...) {
+            workers_.Stop();
+            workersRunning_.store(false);
+            throw;
+        }
 
-                if (!jobQueue_.empty()) {
-                    job = std::move(jobQueue_.front());
-                    jobQueue_.pop();
-                    hasJob = true;
-                    std::cout << "[WORKER " << workerId << "] Picked up job: " 
-                              << job.name() << std::endl;
-                }
-            }
+        FACTORY_LOG_INFO("[CONTROLLER] Started ", minWorkers, " worker threads (up to ",
+                         std::max(minWorkers, maxWorkers), ")");
+    }
 
-            if (hasJob) {
-                try {
-                    executeJob(std::move(job));
-                } catch (const std::exception& e) {
-                    std::cerr << "[WORKER " << workerId << "] Job failed: " 
-                              << e.what() << std::endl;
-                }
-            }
+    void Controller::StopWorkers() noexcept {
+        if (!workersRunning_.exchange(false)) {
+            return;
         }
 
-        std::cout << "[WORKER " << workerId << "] Stopped" << std::endl;
+        {
+            // Keep serving until queued jobs and their continuations have drained
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            stopWorkers_.store(true);
+            queueCV_.wait(lock, [this] { return jobQueue_.Empty() && inFlightJobs_ == 0; });
+        }
+        workers_.Stop();
+        FACTORY_LOG_INFO("[CONTROLLER] Stopped all worker threads");
     }
 
     // ==================== Job Spawner ====================
 
     void Controller::StartJobSpawner(std::function<Job()> jobFactory, int intervalMs) {
         if (spawnerRunning_.exchange(true)) {
-            std::cout << "[CONTROLLER] Job spawner already running" << std::endl;
+            FACTORY_LOG_INFO("[CONTROLLER] Job spawner already running");
             return;
         }
 
@@ -297,8 +800,7 @@ namespace Factory {
         stopSpawner_.store(false);
 
         spawnerThread_ = std::thread(&Controller::JobSpawnerLoop, this);
-        std::cout << "[CONTROLLER] Started job spawner with interval " 
-                  << intervalMs << "ms" << std::endl;
+        FACTORY_LOG_INFO("[CONTROLLER] Started job spawner with interval ", intervalMs, "ms");
     }
 
     void Controller::StopJobSpawner() noexcept {
@@ -311,9 +813,9 @@ namespace Factory {
         if (spawnerThread_.joinable()) {
             try {
                 spawnerThread_.join();
-                std::cout << "[CONTROLLER] Stopped job spawner thread" << std::endl;
+                FACTORY_LOG_INFO("[CONTROLLER] Stopped job spawner thread");
             } catch (...) {
-                std::cerr << "[ERROR] Failed to join job spawner thread" << std::endl;
+                FACTORY_LOG_ERROR("[ERROR] Failed to join job spawner thread");
             }
         }
     }
@@ -328,10 +830,10 @@ namespace Factory {
                 ++jobCounter;
             }
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(spawnerIntervalMs_));
+            clock_->SleepFor(std::chrono::milliseconds(spawnerIntervalMs_));
         }
 
-        std::cout << "[SPAWNER] Total jobs spawned: " << jobCounter << std::endl;
+        FACTORY_LOG_INFO("[SPAWNER] Total jobs spawned: ", jobCounter);
     }
 
 } // namespace Factory
@@ -1,145 +1,539 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <filesystem>
 #include <functional>
-#include <future>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <optional>
 #include <thread>
+#include <typeindex>
+#include <unordered_map>
 #include <vector>
 #include "Machines/MachineTraits.hpp"
+#include "Machines/Core/FactoryLayout.hpp"
 #include "Machines/Core/Mover.hpp"
 #include "Machines/Core/Producer.hpp"
 #include "Machines/Core/ResourceStation.h"
 #include "Materials/AnyMaterial.hpp"
+#include "Clock.hpp"
+#include "TimerQueue.hpp"
 #include "Job.hpp"
+#include "JobQueue.hpp"
+#include "JobCoroutine.hpp"
+#include "Pipeline.hpp"
+#include "Persistence/Journal.hpp"
+#include "Concurrency/WorkStealingPool.hpp"
+#include "Metrics/FactoryMetrics.hpp"
+#include "Tracing/Tracer.hpp"
 #include <boost/signals2.hpp>
 
 namespace Factory {
 
     // Compile-time configurable interval for resource generation (milliseconds)
     inline constexpr int GENERATION_INTERVAL_MS = 300;
+
+    // Kinds the ResourceStation can generate
+    inline constexpr std::array<Data::MaterialKind, 3> RAW_MATERIAL_KINDS = {
+        Data::MaterialKind::MetalPipe,
+        Data::MaterialKind::Gravel,
+        Data::MaterialKind::TitaniumSlab
+    };
+    static_assert(std::ranges::all_of(RAW_MATERIAL_KINDS, Machinery::ResourceStation::Generates),
+                  "the station must be able to generate every raw kind");
+
+    // Items kept in stock on top of the outstanding demand for a kind in demand-driven generation
+    inline constexpr size_t DEFAULT_SAFETY_STOCK = 2;
+
+    enum class GenerationMode {
+        FixedRate,    // round-robin over every raw kind at GENERATION_INTERVAL_MS
+        DemandDriven, // generate just ahead of what queued and running jobs will pull from the station
+    };
+
+    // Simulated back-off before a step that returned RETRY is dispatched again (milliseconds)
+    inline constexpr int RETRY_DELAY_MS = 1000;
+
+    // Number of times a step returning RETRY is dispatched again before its job fails.
+    // Only used for machines without material availability notifications.
+    inline constexpr int MAX_STEP_RETRIES = 3;
+
+    // Default time a step may wait for its material, or for room at its destination, before the job fails (milliseconds)
+    inline constexpr int MATERIAL_WAIT_TIMEOUT_MS = 30000;
     
-    // Default worker pool size
+    // Maximum number of machines per controller; sizes the routing table
+    inline constexpr size_t MAX_MACHINES = 1024;
+    static_assert(Machinery::MAX_GROUP_SIZE >= MAX_MACHINES, "a producer group must fit every machine");
+
+    // Default worker pool bounds; the pool grows towards the maximum while jobs back up
     inline constexpr size_t DEFAULT_WORKER_COUNT = 2;
+    inline constexpr size_t DEFAULT_MAX_WORKER_COUNT = 8;
 
     class Controller {
     public:
-        Controller() = default;
-        
+        /**
+         * @param clock time source shared by the controller loops and every machine added later
+         */
+        explicit Controller(std::shared_ptr<Clock> clock = std::make_shared<RealTimeClock>())
+            : clock_(std::move(clock)) {
+            for (auto& stock : safetyStock_) {
+                stock.store(DEFAULT_SAFETY_STOCK);
+            }
+        }
+
         ~Controller() {
             StopJobSpawner();
             StopWorkers();
             StopResourceGeneration();
+            timers_.Stop();
+            for (auto& machine : ownedMachines_) {
+                machine->StopThread();
+            }
         }
 
         // Template method for type-safe machine registration
-        // Uses SFINAE via MachineTraits to dispatch to correct signal wiring
+        // Uses SFINAE via MachineTraits to pick the routing role; every machine gets a dense id.
+        // Producers of the same type form a pool that shares process commands.
         template<typename MachineT, typename... Args>
         MachineT& AddMachine(Args&&... args) {
             auto machine = std::make_unique<MachineT>(std::forward<Args>(args)...);
             MachineT* ptr = machine.get();
+            ptr->SetClock(*clock_);
+
+            auto group = [this] {
+                if constexpr (is_pooled_producer_v<MachineT>) {
+                    return ProducerGroupFor<MachineT>();
+                } else {
+                    return nullptr;
+                }
+            }();
 
             // Compile-time dispatch based on machine type traits
+            RouteRole role = RouteRole::Other;
             if constexpr (Machinery::is_mover_v<MachineT>) {
-                ConnectMoverSignal(ptr);
+                role = RouteRole::Mover;
             } else if constexpr (Machinery::is_resource_station_v<MachineT>) {
                 if (resourceStation_ != nullptr) {
                     throw std::runtime_error("Only one resource station can be added");
                 }
-                resourceStation_ = ptr;
+                role = RouteRole::Station;
             } else if constexpr (Machinery::is_producer_v<MachineT>) {
-                ConnectProducerSignal(ptr);
+                role = RouteRole::Producer;
             }
 
             ownedMachines_.push_back(std::move(machine));
+            try {
+                RegisterRoute(ptr, role);
+            } catch (...) {
+                ownedMachines_.pop_back();
+                throw;
+            }
+            if (journal_) {
+                ptr->SetInventoryObserver(journal_.get());
+            }
+            if constexpr (Machinery::is_resource_station_v<MachineT>) {
+                resourceStation_ = ptr;
+            }
+            if constexpr (Machinery::is_mover_v<MachineT>) {
+                ptr->SetLayout(layout_);
+                RegisterMover(ptr);
+            }
+            if constexpr (is_pooled_producer_v<MachineT>) {
+                ptr->JoinGroup(std::move(group));
+            }
             ptr->StartThread();
             return *ptr;
         }
 
-        // Starts the resource generation thread
-        void StartResourceGeneration();
+        /** Same as AddMachine, and places the machine on the floor plan movers travel by.
+         * A mover placed this way starts out from that position.
+         */
+        template<typename MachineT, typename... Args>
+        MachineT& AddMachine(Machinery::Position at, Args&&... args) {
+            auto& machine = AddMachine<MachineT>(std::forward<Args>(args)...);
+            layout_->Place(machine.Id(), at);
+            return machine;
+        }
+
+        /** Overrides the route length between two registered machines, e.g. around a wall.
+         * @throws std::invalid_argument if either machine is not registered or meters is negative
+         */
+        void SetDistance(const Machinery::MachineBase& a, const Machinery::MachineBase& b, double meters) {
+            layout_->SetDistance(a.Id(), b.Id(), meters);
+        }
+
+        const Machinery::FactoryLayout& GetLayout() const noexcept { return *layout_; }
+
+        Clock& GetClock() const noexcept { return *clock_; }
+
+        /** Sets how long a step that found no material or no room may stay parked before its job fails.
+         * The deadline spans all wake-ups of that step.
+         */
+        void SetMaterialWaitTimeout(Clock::Duration timeout) noexcept { materialWaitTimeout_.store(timeout.count()); }
+        Clock::Duration GetMaterialWaitTimeout() const noexcept { return Clock::Duration(materialWaitTimeout_.load()); }
+
+        /** Starts the resource generation thread.
+         * In DemandDriven mode every MoveStep that pulls from the station counts as demand from
+         * the moment its job is enqueued until the step succeeds or the job fails. Generation is
+         * triggered as soon as demand rises; the thread only re-checks stock every interval.
+         */
+        void StartResourceGeneration(GenerationMode mode = GenerationMode::FixedRate);
+
+        // Sets the demand-driven safety stock for one kind (kept only while the kind has demand)
+        void SetSafetyStock(Data::MaterialKind kind, size_t count) {
+            safetyStock_.at(static_cast<size_t>(kind)).store(count);
+        }
+
+        // Station-sourced moves of queued and running jobs that have not completed yet
+        long GetOutstandingDemand(Data::MaterialKind kind) const {
+            return demand_.at(static_cast<size_t>(kind)).load();
+        }
 
         // Stops the resource generation thread
         void StopResourceGeneration() noexcept;
 
-        // Signals
+        // Observer signals, fired for every dispatched step once enabled via EnableStepObservers.
+        // Commands themselves are routed directly to their target machine, not through these.
         boost::signals2::signal<void (
-                Machinery::Mover* mover,
+                const Machinery::Mover& mover,
                 Data::MaterialKind material,
-                Machinery::MachineBase& source,
-                Machinery::MachineBase& destination,
-                std::promise<StepStatus>& cmdCompleted
-        )> onTransportRequested;
+                const Machinery::MachineBase& source,
+                const Machinery::MachineBase& destination
+        )> onTransportDispatched;
 
         boost::signals2::signal<void (
                 Data::MaterialKind material,
-                Machinery::MachineBase& target,
-                std::promise<StepStatus>& cmdCompleted
-        )> onProcessRequested;
+                const Machinery::MachineBase& target
+        )> onProcessDispatched;
+
+        void EnableStepObservers(bool enabled) noexcept { observersEnabled_.store(enabled); }
 
+        /** Starts executing a job and returns immediately.
+         * Every step whose dependencies have succeeded is dispatched to its machine at once;
+         * each completion posts a continuation to the worker pool, which dispatches the steps
+         * it unblocked. No thread blocks while a machine is working, so a few workers can
+         * drive any number of jobs.
+         */
         void executeJob(Job job);
 
-        // Job queue management
+        /** Starts a coroutine job and returns immediately.
+         * The coroutine first runs on a worker and is resumed on a worker after every
+         * awaited step, so it never holds a thread while a machine is working.
+         *
+         * @throws std::bad_alloc
+         * Exception guarantee: strong
+         */
+        void Spawn(std::string name, JobCoroutine job);
+
+        /** Starts a typed pipeline and returns immediately.
+         * Stages run in order and the items of a move stage are carried in parallel. Each
+         * command is queued straight onto the pipeline's typed machines, without a JobStep
+         * variant, route lookup or Command variant on the way; waiting for material or space,
+         * retries, station demand, metrics and traces work as for executeJob. Its machines
+         * must be registered here.
+         *
+         * @param onDone called once with the job's outcome, on a worker
+         * @throws std::bad_alloc
+         * Exception guarantee: strong
+         */
+        template<class... Stages>
+        void Launch(std::string name, const Pipeline<Stages...>& pipeline,
+                    std::function<void(bool succeeded)> onDone = {});
+
+        // Job queue management. Queued jobs start by priority class and deadline, see JobQueue.
         void EnqueueJob(Job job);
+
+        /** Journals submitted jobs, their step completions and every machine's stock changes to
+         * `directory`, and resumes what an earlier run left there: stock is put back, with fresh
+         * payloads, and unfinished jobs are enqueued again, skipping the steps they completed.
+         * Producer input that no resumed job will process is dropped rather than put back.
+         * Steps that were running when the earlier run stopped run again. Coroutine jobs and
+         * launched pipelines are not journaled.
+         * Call once, after registering the same machines in the same order as the earlier run
+         * and before any machine holds material or any job is submitted.
+         *
+         * @return number of jobs resumed
+         * @throws std::logic_error if a journal is enabled already
+         * @throws std::system_error if the journal cannot be opened, std::runtime_error if it is corrupt
+         */
+        size_t EnableJournal(const std::filesystem::path& directory);
+
+        // The journal, or nullptr if none is enabled
+        const Persistence::Journal* GetJournal() const noexcept { return journal_.get(); }
+
+        // Queue wait per priority class, indexed by JobPriority
+        std::array<QueueWaitStats, JOB_PRIORITY_COUNT> GetQueueWaitStats() const {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            return jobQueue_.WaitStats();
+        }
         
         // Job spawner - spawns jobs at interval using factory function
         void StartJobSpawner(std::function<Job()> jobFactory, int intervalMs);
         void StopJobSpawner() noexcept;
         
-        // Worker pool management
-        void StartWorkers(size_t workerCount = DEFAULT_WORKER_COUNT);
+        /** Starts the work-stealing worker pool with `minWorkers` threads, growing up to
+         * `maxWorkers` (at least `minWorkers`) while queued work backs up.
+         *
+         * @throws std::invalid_argument if minWorkers is 0 or above MAX_POOL_WORKERS
+         * @throws std::system_error if a thread cannot be started
+         */
+        void StartWorkers(size_t minWorkers = DEFAULT_WORKER_COUNT, size_t maxWorkers = DEFAULT_MAX_WORKER_COUNT);
+        // Waits for queued and running jobs to drain, then stops the pool
         void StopWorkers() noexcept;
 
+        size_t WorkerCount() const noexcept { return workers_.WorkerCount(); }
+
+        /** Snapshot of every registered machine's metrics plus job outcomes and latency.
+         *
+         * @throws std::bad_alloc
+         */
+        Metrics::FactoryMetrics CollectMetrics() const;
+
     private:
-        // Signal connection helpers using std::bind
-        void ConnectMoverSignal(Machinery::Mover* mover);
-        void ConnectProducerSignal(Machinery::MachineBase* producer);
-
-        // Signal handlers (bound via std::bind)
-        void HandleTransport(
-            Machinery::Mover* targetMover,
-            Machinery::Mover* requestedMover,
-            Data::MaterialKind kind,
-            Machinery::MachineBase& source,
-            Machinery::MachineBase& destination,
-            std::promise<StepStatus>& cmdCompleted
-        );
-
-        void HandleProcess(
-            Machinery::MachineBase* targetProducer,
-            Data::MaterialKind kind,
-            Machinery::MachineBase& requestedTarget,
-            std::promise<StepStatus>& cmdCompleted
-        );
-
-        void executeJobStep(const JobStep& step, std::promise<StepStatus>& promise);
+        friend class StepAwaiter;
+        friend class DelayAwaiter;
+        friend class MaterialAwaiter;
+
+        // Routing table: machine id -> machine, O(1) and lock-free to read
+        enum class RouteRole : std::uint8_t {
+            Mover,
+            Producer,
+            Station,
+            Other,
+        };
+
+        struct Route {
+            Machinery::MachineBase* machine{nullptr};
+            RouteRole role{RouteRole::Other};
+        };
+
+        /** Assigns the next dense id to the machine and publishes its route.
+         * @throws std::length_error if MAX_MACHINES machines are already registered
+         * Exception guarantee: strong
+         */
+        void RegisterRoute(Machinery::MachineBase* machine, RouteRole role);
+
+        /** Looks up the registered machine for a command of the given role.
+         * @throws std::invalid_argument if the machine is not registered here or cannot handle the role
+         */
+        Machinery::MachineBase& Resolve(const Machinery::MachineBase& machine, RouteRole role) const;
+
+        template<typename MachineT>
+        static constexpr bool is_pooled_producer_v = Machinery::is_producer_v<MachineT> &&
+            requires { typename MachineT::InputType; };
+
+        // Group shared by all producers of exactly this machine type, created on first use
+        template<typename MachineT>
+        std::shared_ptr<Machinery::ProducerGroup<typename MachineT::InputType>> ProducerGroupFor() {
+            using Group = Machinery::ProducerGroup<typename MachineT::InputType>;
+            auto& group = producerGroups_[std::type_index(typeid(MachineT))];
+            if (!group) {
+                group = std::make_shared<Group>();
+            }
+            return std::static_pointer_cast<Group>(group);
+        }
+
+        // Adds a registered mover to the pool used by MoveSteps that do not pin a mover
+        void RegisterMover(Machinery::Mover* mover) noexcept;
+
+        /** Picks the pool mover for `items` transports from `source`: the idle mover closest to
+         * it if there is one, else one whose last queued trip from that source has room for
+         * them, else the mover with the fewest queued commands. Ties rotate between movers.
+         * @throws std::invalid_argument if no mover is registered
+         */
+        Machinery::Mover& PickMover(const Machinery::MachineBase& source, size_t items);
+
+        /** Hands transports from one source to pool movers in shared trips of up to each
+         * mover's capacity.
+         * @throws std::invalid_argument if no mover is registered, std::bad_alloc
+         * Exception guarantee: basic
+         * Trips handed over before a throw stay queued.
+         */
+        void DispatchTransports(Machinery::MachineBase& source, std::vector<Machinery::TransportCommand> loads);
+
+        // Progress of one step of a job in flight
+        struct StepState {
+            size_t pendingDependencies{0};
+            bool done{false};
+            int retries{0};
+            std::optional<Clock::TimePoint> waitDeadline; // set while the step waits for material or space
+        };
+
+        // State of a job in flight, shared by the continuations of its steps.
+        // Parallel steps complete on different workers, so the state is guarded by `mutex`.
+        // Steps marked completed, e.g. in a resumed job, start out done.
+        struct JobExecution {
+            explicit JobExecution(Job j) : job(std::move(j)), steps(job.stepCount()), remaining(job.stepCount()) {
+                for (StepId id = 0; id < steps.size(); ++id) {
+                    const auto& dependencies = job.dependencies(id);
+                    steps[id].pendingDependencies = static_cast<size_t>(std::count_if(
+                        dependencies.begin(), dependencies.end(), [this](StepId d) { return !job.completed(d); }));
+                    if (job.completed(id)) {
+                        steps[id].done = true;
+                        --remaining;
+                    }
+                }
+            }
+
+            Job job;
+            std::vector<StepState> steps;
+            size_t remaining;
+            bool finished{false};
+            size_t worker{Concurrency::NO_WORKER}; // pool worker that started the job
+            std::mutex mutex;
+        };
+        using ExecutionPtr = std::shared_ptr<JobExecution>;
+
+        void StartJob(Job job);
+
+        /** Stamps a job with a journal id and journals it, unless no journal is enabled or the
+         * job is being resumed and so journaled already.
+         * Exception guarantee: strong
+         */
+        void JournalJob(Job& job);
+        // Dispatches steps whose dependencies have all succeeded
+        void StartSteps(const ExecutionPtr& execution, const std::vector<StepId>& ready);
+        void DispatchStep(const ExecutionPtr& execution, StepId id);
+        // Dispatches pool move steps together, so those from the same source share trips
+        void DispatchMoves(const ExecutionPtr& execution, std::vector<StepId> moves);
+        Machinery::Completion StepCompletion(const ExecutionPtr& execution, StepId id);
+        void OnStepCompleted(const ExecutionPtr& execution, StepId id, StepStatus status);
+
+        // Parks a step that returned RETRY (BLOCKED) until its material (room for it) shows up
+        // or its deadline passes
+        void ParkStep(const ExecutionPtr& execution, StepId id, StepStatus reason);
+
+        // Fallback for machines without availability notifications: re-dispatch after a fixed delay
+        void RetryAfterDelay(const ExecutionPtr& execution, StepId id);
+        void FinishJob(const std::string& jobName, const char* failure, Clock::TimePoint submittedAt) noexcept;
+        // Finishes the job once, however many of its parallel steps fail, and withdraws the
+        // demand of its unfinished steps
+        void FinishJob(const ExecutionPtr& execution, const char* failure) noexcept;
+        // Closes the trace spans of the steps a failed job leaves unfinished; caller holds execution.mutex
+        void TraceAbandonedSteps(const JobExecution& execution, const char* failure) noexcept;
+        void executeJobStep(const JobStep& step, Machinery::Completion onCompleted);
+
+        /** Parks until `machine` has material of `kind` (room for it if `forSpace`): `resume` is
+         * posted once it shows up, or `expire` once `timeout` passes, whichever comes first.
+         * Returns false, without parking, if the machine has no availability notifications.
+         *
+         * @throws std::bad_alloc
+         */
+        bool Park(Machinery::MachineBase& machine, Data::MaterialKind kind, bool forSpace, Clock::Duration timeout,
+                  size_t worker, std::function<void()> resume, std::function<void()> expire);
+
+        // State of a typed pipeline in flight, shared by the continuations of its commands
+        template<class... Stages>
+        struct PipelineExecution {
+            PipelineExecution(std::string n, const std::tuple<Stages...>& s, Clock::TimePoint at,
+                              std::function<void(bool)> done)
+                : name(std::move(n)), stages(s), submittedAt(at), onDone(std::move(done)) {}
+
+            std::string name;
+            std::tuple<Stages...> stages;
+            Clock::TimePoint submittedAt;
+            std::function<void(bool)> onDone;
+            size_t worker{Concurrency::NO_WORKER};
+            size_t stage{0};   // stage running now
+            size_t pending{0}; // commands of that stage that have not succeeded yet
+            std::array<long, Data::MATERIAL_KIND_COUNT> demand{}; // station-sourced items not moved yet
+            bool finished{false};
+            std::mutex mutex;
+        };
+
+        // One command of a running stage
+        struct PipelineItem {
+            int retries{0};
+            std::optional<Clock::TimePoint> waitDeadline; // set while the command waits for material or space
+        };
+        using PipelineItemPtr = std::shared_ptr<PipelineItem>;
+
+        template<size_t I, class Execution>
+        void StartStage(const std::shared_ptr<Execution>& execution);
+        // Dispatches items of stage I; the items of a move stage share trips
+        template<size_t I, class Execution>
+        void DispatchStageItems(const std::shared_ptr<Execution>& execution, const std::vector<PipelineItemPtr>& items);
+        template<size_t I, class Execution>
+        void OnStageItemCompleted(const std::shared_ptr<Execution>& execution, const PipelineItemPtr& item,
+                                  StepStatus status);
+        template<size_t I, class Execution>
+        void ParkStageItem(const std::shared_ptr<Execution>& execution, const PipelineItemPtr& item,
+                           StepStatus reason);
+        // Finishes the pipeline once and withdraws the demand of the items it did not move
+        template<class Execution>
+        void FinishPipeline(const std::shared_ptr<Execution>& execution, const char* failure) noexcept;
+
+        // Queues a continuation for the worker pool, preferably on `worker`
+        void Post(std::function<void()> task, size_t worker = Concurrency::NO_WORKER);
+
+        // Pool source: removes the next queued job, if any, as a task that starts it
+        std::function<void()> NextJob();
+
+        // Shared simulation clock, declared first so it outlives the machines using it
+        std::shared_ptr<Clock> clock_;
+
+        // Delayed continuations (retry back-off)
+        TimerQueue timers_{*clock_};
+
+        // Declared before the machines, so it outlives every machine reporting stock to it
+        std::unique_ptr<Persistence::Journal> journal_;
 
         // Resource generation thread loop
         void ResourceGenerationLoop();
 
+        // Adds `delta` to the demand of a MoveStep sourced at the station; other steps are ignored.
+        // Raising demand generates the shortfall right away.
+        void AdjustDemand(const JobStep& step, long delta);
+        void WithdrawDemand(const JobExecution& execution) noexcept; // caller holds execution.mutex
+
+        // Enqueues generation until stock plus pending generation covers demand and safety stock
+        void Replenish(Data::MaterialKind kind);
+
         // Owned machines with unique_ptr for proper lifetime management
         std::vector<std::unique_ptr<Machinery::MachineBase>> ownedMachines_;
 
+        std::unique_ptr<Route[]> routes_{std::make_unique<Route[]>(MAX_MACHINES)};
+        std::atomic<size_t> routeCount_{0};
+        std::mutex routesMutex_; // serializes registration only
+        std::unique_ptr<Machinery::Mover*[]> movers_{std::make_unique<Machinery::Mover*[]>(MAX_MACHINES)};
+        std::shared_ptr<Machinery::FactoryLayout> layout_{std::make_shared<Machinery::FactoryLayout>()};
+        std::atomic<size_t> moverCount_{0};
+        std::atomic<size_t> moverCursor_{0};
+        std::unordered_map<std::type_index, std::shared_ptr<void>> producerGroups_;
+        std::atomic_bool observersEnabled_{false};
+        std::atomic<Clock::Duration::rep> materialWaitTimeout_{
+            std::chrono::duration_cast<Clock::Duration>(std::chrono::milliseconds(MATERIAL_WAIT_TIMEOUT_MS)).count()};
+
         // Resource generation thread members
         Machinery::ResourceStation* resourceStation_{nullptr};
         std::thread resourceGenThread_;
         std::atomic_bool stopGeneration_{false};
         std::atomic_bool generationRunning_{false};
+        std::atomic<GenerationMode> generationMode_{GenerationMode::FixedRate};
+        std::array<std::atomic<long>, Data::MATERIAL_KIND_COUNT> demand_{};
+        std::array<std::atomic<long>, Data::MATERIAL_KIND_COUNT> pendingGeneration_{};
+        std::array<std::atomic<size_t>, Data::MATERIAL_KIND_COUNT> safetyStock_{};
+        std::mutex generationMutex_; // serializes Replenish
 
         // Job queue members (thread-safe)
-        std::queue<Job> jobQueue_;
-        std::mutex queueMutex_;
-        std::condition_variable queueCV_;
+        JobQueue jobQueue_; // by priority class, then earliest deadline
+        size_t inFlightJobs_{0};
+        mutable std::mutex queueMutex_;
+        std::condition_variable queueCV_; // signals StopWorkers once in-flight jobs drain
 
-        // Worker pool members
-        std::vector<std::thread> workers_;
+        // Job outcome metrics
+        Metrics::Histogram jobLatency_;
+        Metrics::Counter jobsFinished_;
+        Metrics::Counter jobsFailed_;
+
+        // Worker pool members. Continuations run on per-worker deques and are served before
+        // new jobs, which idle workers take from jobQueue_.
+        Concurrency::WorkStealingPool workers_;
         std::atomic_bool stopWorkers_{false};
         std::atomic_bool workersRunning_{false};
-        void WorkerLoop(size_t workerId);
 
         // Job spawner members
         std::thread spawnerThread_;
@@ -151,3 +545,5 @@ namespace Factory {
     };
 
 } // namespace Factory
+
+#include "Controller-inl.hpp"
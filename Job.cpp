@@ -1,30 +1,117 @@
 #include "Job.hpp"
 
-#include <exception>
+#include <stdexcept>
 namespace Factory {
 
+    std::string describeStep(const JobStep& step) {
+        return std::visit([](const auto& s) {
+            using S = std::decay_t<decltype(s)>;
+            if constexpr (std::is_same_v<S, MoveStep>) {
+                return "move " + Data::toString(s.material) + " " + std::string(s.source.get().Name()) + " -> "
+                       + std::string(s.destination.get().Name());
+            } else {
+                return "process " + Data::toString(s.material) + " @ " + std::string(s.executor.get().Name());
+            }
+        }, step);
+    }
+
     Job::Job(std::string name) : name_(name) {};
 
-    void Job::addStep(JobStep step) {
-        steps_.push(step);
+    StepId Job::addStep(JobStep step) {
+        if (nodes_.empty()) {
+            return addStep(std::move(step), std::vector<StepId>{});
+        }
+        return addStep(std::move(step), std::vector<StepId>{nodes_.size() - 1});
+    }
+
+    StepId Job::addStep(JobStep step, std::initializer_list<StepId> dependsOn) {
+        return addStep(std::move(step), std::vector<StepId>(dependsOn));
     }
 
-    const JobStep& Job::getNextStep() const {
-        if(steps_.empty()) {
-            throw std::out_of_range("no steps left in the job");
+    StepId Job::addStep(JobStep step, const std::vector<StepId>& dependsOn) {
+        const StepId id = nodes_.size();
+        for (StepId dependency : dependsOn) {
+            if (dependency >= id) {
+                throw std::out_of_range("step dependency does not name an earlier step");
+            }
+        }
+        nodes_.push_back(Node{std::move(step), dependsOn, {}, false});
+        size_t linked = 0;
+        try {
+            for (; linked < dependsOn.size(); ++linked) {
+                nodes_[dependsOn[linked]].dependents.push_back(id);
+            }
+        } catch (...) {
+            for (size_t i = 0; i < linked; ++i) {
+                nodes_[dependsOn[i]].dependents.pop_back();
+            }
+            nodes_.pop_back();
+            throw;
         }
-        return steps_.front();
+        return id;
+    }
+
+    const JobStep& Job::step(StepId id) const {
+        return nodes_.at(id).step;
     }
 
-    void Job::popStep() {
-        steps_.pop();
+    const std::vector<StepId>& Job::dependencies(StepId id) const {
+        return nodes_.at(id).dependencies;
     }
 
-    bool Job::stepsEmpty() {
-        return steps_.empty();
+    const std::vector<StepId>& Job::dependents(StepId id) const {
+        return nodes_.at(id).dependents;
     }
 
-    std::string Job::name() {
+    std::size_t Job::stepCount() const noexcept {
+        return nodes_.size();
+    }
+
+    bool Job::stepsEmpty() const noexcept {
+        return nodes_.empty();
+    }
+
+    std::string Job::name() const {
         return name_;
     }
+
+    void Job::setPriority(JobPriority priority) noexcept {
+        priority_ = priority;
+    }
+
+    JobPriority Job::priority() const noexcept {
+        return priority_;
+    }
+
+    void Job::setDeadline(Clock::TimePoint deadline) noexcept {
+        deadline_ = deadline;
+    }
+
+    const std::optional<Clock::TimePoint>& Job::deadline() const noexcept {
+        return deadline_;
+    }
+
+    void Job::setSubmittedAt(Clock::TimePoint submittedAt) noexcept {
+        submittedAt_ = submittedAt;
+    }
+
+    Clock::TimePoint Job::submittedAt() const noexcept {
+        return submittedAt_;
+    }
+
+    void Job::setJournalId(std::uint64_t id) noexcept {
+        journalId_ = id;
+    }
+
+    const std::optional<std::uint64_t>& Job::journalId() const noexcept {
+        return journalId_;
+    }
+
+    void Job::markCompleted(StepId id) {
+        nodes_.at(id).completed = true;
+    }
+
+    bool Job::completed(StepId id) const {
+        return nodes_.at(id).completed;
+    }
 }
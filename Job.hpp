@@ -2,42 +2,125 @@
 
 #include "Machines/Core/MachineBase.hpp"
 #include "Machines/Core/Mover.hpp"
+#include "Clock.hpp"
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
-#include <queue>
+#include <initializer_list>
+#include <optional>
 #include <string>
 #include <variant>
+#include <vector>
 
 namespace Factory {
 
 
     struct MoveStep {
-        std::reference_wrapper<Machinery::Mover> mover;
         Data::MaterialKind material;
         std::reference_wrapper<Machinery::MachineBase> source;
         std::reference_wrapper<Machinery::MachineBase> destination;
+        // Pins the step to one mover; otherwise the Controller picks the least-loaded one
+        std::optional<std::reference_wrapper<Machinery::Mover>> mover{};
     };
 
     struct ProcessStep {
         std::reference_wrapper<Machinery::MachineBase> executor;
         Data::MaterialKind material;
-        Data::MaterialKind product; // currently unused by Controller
+        Data::MaterialKind product; // awaited for output space when the step is BLOCKED
+        size_t maxItems{1};         // batch step: process up to this many items in one cycle
     };
 
     using JobStep = std::variant<MoveStep, ProcessStep>;
 
+    // Human-readable summary of a step, e.g. "move MetalPipe Resource_Station -> Cutter-1"
+    std::string describeStep(const JobStep& step);
+
+    // Index of a step within its job, in the order the steps were added
+    using StepId = std::size_t;
+
+    // Service class of a job; lower classes are served first
+    enum class JobPriority : std::uint8_t {
+        Urgent,
+        High,
+        Normal,
+        Low,
+    };
+
+    inline constexpr std::size_t JOB_PRIORITY_COUNT = 4;
+
+    constexpr const char* toString(JobPriority priority) noexcept {
+        switch (priority) {
+            case JobPriority::Urgent: return "Urgent";
+            case JobPriority::High: return "High";
+            case JobPriority::Normal: return "Normal";
+            case JobPriority::Low: return "Low";
+        }
+        return "Unknown";
+    }
+
+    /**
+     * A job is a graph of steps. A step may start once every step it depends on has
+     * succeeded; steps without a dependency path between them run in parallel.
+     * Steps can only depend on steps added before them, so the graph is always acyclic.
+     */
     class Job {
     public:
         Job(std::string name);
-        void addStep(JobStep step);
-        const JobStep& getNextStep() const;
-        void popStep();
-        bool stepsEmpty();
-        std::string name();
+
+        // Adds a step that depends on the previously added step, i.e. a sequential job
+        StepId addStep(JobStep step);
+
+        /** Adds a step that depends on exactly the given steps; none means it can start right away.
+         * @throws std::out_of_range if a dependency does not name an existing step
+         * Exception guarantee: strong
+         */
+        StepId addStep(JobStep step, std::initializer_list<StepId> dependsOn);
+        StepId addStep(JobStep step, const std::vector<StepId>& dependsOn);
+
+        const JobStep& step(StepId id) const;
+        const std::vector<StepId>& dependencies(StepId id) const;
+        const std::vector<StepId>& dependents(StepId id) const;
+        std::size_t stepCount() const noexcept;
+        bool stepsEmpty() const noexcept;
+        std::string name() const;
+
+        void setPriority(JobPriority priority) noexcept;
+        JobPriority priority() const noexcept;
+
+        // Simulated time by which the job should have started; jobs of one class are served earliest deadline first
+        void setDeadline(Clock::TimePoint deadline) noexcept;
+        const std::optional<Clock::TimePoint>& deadline() const noexcept;
+
+        // Simulated time the job was handed to the Controller; stamped on enqueue, start of its end-to-end latency
+        void setSubmittedAt(Clock::TimePoint submittedAt) noexcept;
+        Clock::TimePoint submittedAt() const noexcept;
+
+        // Sequence number of the job in the Controller's journal; stamped when a journaled job is submitted
+        void setJournalId(std::uint64_t id) noexcept;
+        const std::optional<std::uint64_t>& journalId() const noexcept;
+
+        /** Marks a step as completed before the job starts, e.g. when resuming a journaled job.
+         * The step is not run again and its dependents start without waiting for it.
+         * @throws std::out_of_range if the id does not name a step
+         */
+        void markCompleted(StepId id);
+        bool completed(StepId id) const;
 
     private:
+        struct Node {
+            JobStep step;
+            std::vector<StepId> dependencies;
+            std::vector<StepId> dependents;
+            bool completed{false};
+        };
+
         std::string name_;
-        std::queue<JobStep> steps_;
+        std::vector<Node> nodes_;
+        JobPriority priority_{JobPriority::Normal};
+        std::optional<Clock::TimePoint> deadline_;
+        Clock::TimePoint submittedAt_{};
+        std::optional<std::uint64_t> journalId_;
     };
 }
 
@@ -0,0 +1,67 @@
+#include "JobCoroutine.hpp"
+#include "Controller.hpp"
+
+namespace Factory {
+
+    void StepAwaiter::await_suspend(JobCoroutine::Handle handle) {
+        Controller* controller = handle.promise().controller;
+        const size_t worker = controller->workers_.CurrentWorker(); // resume where the coroutine ran
+        // A coroutine's steps are not known ahead, so its demand only spans the awaited step
+        controller->AdjustDemand(step_, +1);
+        std::string traceName, traceId;
+        if (Tracing::Tracer::Instance().Enabled()) {
+            auto& promise = handle.promise();
+            traceName = "step " + std::to_string(++promise.stepsAwaited);
+            traceId = promise.name + "/" + std::to_string(promise.stepsAwaited);
+            Tracing::Tracer::Instance().AsyncBegin(
+                "step", traceName, traceId,
+                {{"job", promise.name}, {"step", describeStep(step_)},
+                 {"worker", worker == Concurrency::NO_WORKER ? "-" : std::to_string(worker)}});
+        }
+        try {
+            controller->executeJobStep(step_, [this, controller, handle, worker, traceName, traceId](StepStatus status) {
+                controller->AdjustDemand(step_, -1);
+                status_ = status;
+                if (!traceId.empty()) {
+                    FACTORY_TRACE(AsyncEnd, "step", traceName, traceId, {{"status", Metrics::toString(status)}});
+                }
+                controller->Post([handle] { handle.resume(); }, worker);
+            });
+        } catch (...) {
+            controller->AdjustDemand(step_, -1);
+            throw;
+        }
+    }
+
+    void DelayAwaiter::await_suspend(JobCoroutine::Handle handle) {
+        Controller* controller = handle.promise().controller;
+        const size_t worker = controller->workers_.CurrentWorker();
+        controller->timers_.ScheduleAfter(delay_, [controller, handle, worker] {
+            controller->Post([handle] { handle.resume(); }, worker);
+        });
+    }
+
+    bool MaterialAwaiter::await_suspend(JobCoroutine::Handle handle) {
+        // Once subscribed, the coroutine may resume on another thread and destroy this awaiter,
+        // so nothing below the subscription touches a member
+        Controller* controller = handle.promise().controller;
+        const size_t worker = controller->workers_.CurrentWorker();
+        Machinery::MachineBase& machine = machine_;
+        const auto kind = kind_;
+        const auto timeout = timeout_;
+        const bool forSpace = forSpace_;
+        auto wait = std::make_shared<Machinery::MaterialWait>([controller, handle, worker] {
+            controller->Post([handle] { handle.resume(); }, worker);
+        });
+        wait_ = wait;
+        if (!(forSpace ? machine.NotifyWhenSpace(kind, wait) : machine.NotifyWhenAvailable(kind, wait))) {
+            return false;
+        }
+        controller->timers_.ScheduleAfter(timeout, [controller, handle, wait, worker] {
+            if (wait->TryClaim()) {
+                controller->Post([handle] { handle.resume(); }, worker);
+            }
+        });
+        return true;
+    }
+}
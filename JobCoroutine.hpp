@@ -0,0 +1,193 @@
+#pragma once
+
+#include "Job.hpp"
+#include "Clock.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <string>
+#include <utility>
+
+namespace Factory {
+
+    class Controller;
+
+    /**
+     * A job written as a C++20 coroutine, e.g.
+     *
+     *     JobCoroutine cutOne(Mover& arm, ResourceStation& station, Cutter<MetalPipe>& cutter) {
+     *         while (co_await Move(arm, MaterialKind::MetalPipe, station, cutter) == RETRY) {
+     *             if (!co_await WaitForMaterial(station, MaterialKind::MetalPipe, 10s)) {
+     *                 co_return;
+     *             }
+     *         }
+     *         // Pooled producers may hand the delivered item to a sibling, so processing can wait too
+     *         while (co_await Process(cutter, MaterialKind::MetalPipe) == RETRY) {
+     *             if (!co_await WaitForMaterial(cutter, MaterialKind::MetalPipe, 10s)) {
+     *                 co_return;
+     *             }
+     *         }
+     *     }
+     *
+     * The coroutine starts suspended and is started by Controller::Spawn. Each awaited
+     * step is dispatched to its machine and the coroutine is resumed on a controller
+     * worker once the step completes; no thread blocks while the step runs.
+     */
+    class JobCoroutine {
+    public:
+        struct promise_type {
+            Controller* controller{nullptr};
+            std::string name;           // job name, set by Controller::Spawn
+            size_t stepsAwaited{0};     // numbers the steps in traces
+            std::function<void(std::exception_ptr)> onDone;
+            std::exception_ptr error;
+
+            JobCoroutine get_return_object() noexcept {
+                return JobCoroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            // Frees the frame and reports the outcome to the controller
+            struct FinalAwaiter {
+                bool await_ready() noexcept { return false; }
+
+                void await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                    auto onDone = std::move(handle.promise().onDone);
+                    auto error = handle.promise().error;
+                    handle.destroy();
+                    if (onDone) {
+                        onDone(error);
+                    }
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            FinalAwaiter final_suspend() noexcept { return {}; }
+
+            void return_void() noexcept {}
+
+            void unhandled_exception() noexcept { error = std::current_exception(); }
+        };
+
+        using Handle = std::coroutine_handle<promise_type>;
+
+        JobCoroutine(JobCoroutine&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+        JobCoroutine& operator=(JobCoroutine&& other) noexcept {
+            if (this != &other) {
+                if (handle_) {
+                    handle_.destroy();
+                }
+                handle_ = std::exchange(other.handle_, {});
+            }
+            return *this;
+        }
+
+        JobCoroutine(const JobCoroutine&) = delete;
+        JobCoroutine& operator=(const JobCoroutine&) = delete;
+
+        ~JobCoroutine() {
+            if (handle_) {
+                handle_.destroy();
+            }
+        }
+
+        // Transfers ownership of the suspended frame to the caller
+        Handle Release() noexcept { return std::exchange(handle_, {}); }
+
+    private:
+        explicit JobCoroutine(Handle handle) noexcept : handle_(handle) {}
+
+        Handle handle_;
+    };
+
+    // Awaits one job step; evaluates to the step's StepStatus
+    class StepAwaiter {
+    public:
+        explicit StepAwaiter(JobStep step) : step_(std::move(step)) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        /** Dispatches the step on the awaiting coroutine's controller.
+         * @throws std::exception if the step cannot be dispatched; it is rethrown inside the coroutine
+         */
+        void await_suspend(JobCoroutine::Handle handle);
+
+        StepStatus await_resume() const noexcept { return status_; }
+
+    private:
+        JobStep step_;
+        StepStatus status_{ERROR};
+    };
+
+    // Suspends the coroutine for a span of simulated time without holding a worker
+    class DelayAwaiter {
+    public:
+        explicit DelayAwaiter(Clock::Duration delay) noexcept : delay_(delay) {}
+
+        bool await_ready() const noexcept { return delay_ <= Clock::Duration::zero(); }
+
+        void await_suspend(JobCoroutine::Handle handle);
+
+        void await_resume() const noexcept {}
+
+    private:
+        Clock::Duration delay_;
+    };
+
+    // Suspends until material of a kind (or room for it) is available at a machine; evaluates to false on timeout
+    class MaterialAwaiter {
+    public:
+        MaterialAwaiter(Machinery::MachineBase& machine, Data::MaterialKind kind, Clock::Duration timeout,
+                        bool forSpace = false) noexcept
+            : machine_(machine), kind_(kind), timeout_(timeout), forSpace_(forSpace) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        // Returns false (resume immediately) if the machine does not support notifications
+        bool await_suspend(JobCoroutine::Handle handle);
+
+        bool await_resume() const noexcept { return wait_ && wait_->fired.load(); }
+
+    private:
+        Machinery::MachineBase& machine_;
+        Data::MaterialKind kind_;
+        Clock::Duration timeout_;
+        bool forSpace_;
+        Machinery::MaterialWaitPtr wait_; // outlives the awaiter in the machine's queue and the timer
+    };
+
+    // Dispatched to whichever mover of the pool is least loaded
+    inline StepAwaiter Move(Data::MaterialKind material, Machinery::MachineBase& source,
+                            Machinery::MachineBase& destination) {
+        return StepAwaiter(MoveStep{material, source, destination});
+    }
+
+    inline StepAwaiter Move(Machinery::Mover& mover, Data::MaterialKind material,
+                            Machinery::MachineBase& source, Machinery::MachineBase& destination) {
+        return StepAwaiter(MoveStep{material, source, destination, mover});
+    }
+
+    inline StepAwaiter Process(Machinery::MachineBase& executor, Data::MaterialKind material,
+                               Data::MaterialKind product = Data::MaterialKind::Invalid, size_t maxItems = 1) {
+        return StepAwaiter(ProcessStep{executor, material, product, maxItems});
+    }
+
+    inline DelayAwaiter Delay(Clock::Duration delay) noexcept {
+        return DelayAwaiter(delay);
+    }
+
+    inline MaterialAwaiter WaitForMaterial(Machinery::MachineBase& machine, Data::MaterialKind kind,
+                                           Clock::Duration timeout) noexcept {
+        return MaterialAwaiter(machine, kind, timeout);
+    }
+
+    // Awaited after a step returned BLOCKED
+    inline MaterialAwaiter WaitForSpace(Machinery::MachineBase& machine, Data::MaterialKind kind,
+                                        Clock::Duration timeout) noexcept {
+        return MaterialAwaiter(machine, kind, timeout, true);
+    }
+}
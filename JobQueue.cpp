@@ -0,0 +1,65 @@
+#include "JobQueue.hpp"
+
+#include <algorithm>
+
+namespace Factory {
+
+    void JobQueue::Push(Job job, Clock::TimePoint now) {
+        auto& queue = classes_[static_cast<size_t>(job.priority())];
+        const auto sequence = nextSequence_;
+        const auto deadline = job.deadline().value_or(Clock::TimePoint::max());
+
+        auto it = queue.byArrival.emplace(sequence, Entry{std::move(job), now}).first;
+        try {
+            queue.byDeadline.emplace(deadline, sequence);
+        } catch (...) {
+            queue.byArrival.erase(it);
+            throw;
+        }
+        ++nextSequence_;
+        ++size_;
+    }
+
+    std::optional<Job> JobQueue::Pop(Clock::TimePoint now) {
+        // Effective class of each non-empty class is set by how long its oldest job has waited
+        size_t chosen = JOB_PRIORITY_COUNT;
+        size_t chosenRank = JOB_PRIORITY_COUNT;
+        for (size_t c = 0; c < JOB_PRIORITY_COUNT; ++c) {
+            const auto& queue = classes_[c];
+            if (queue.byArrival.empty()) {
+                continue;
+            }
+            const auto waited = now - queue.byArrival.begin()->second.enqueuedAt;
+            const size_t steps = aging_ > Clock::Duration::zero() && waited > Clock::Duration::zero()
+                                     ? static_cast<size_t>(waited / aging_) : 0;
+            const size_t rank = c > steps ? c - steps : 0;
+            if (rank <= chosenRank) { // on a tie the promoted, longer-waiting class wins
+                chosen = c;
+                chosenRank = rank;
+            }
+        }
+        if (chosen == JOB_PRIORITY_COUNT) {
+            return std::nullopt;
+        }
+
+        auto& queue = classes_[chosen];
+        const bool promoted = chosenRank < chosen;
+        const std::uint64_t sequence = promoted ? queue.byArrival.begin()->first : queue.byDeadline.begin()->second;
+        auto it = queue.byArrival.find(sequence);
+
+        Job job = std::move(it->second.job);
+        const auto waited = now - it->second.enqueuedAt;
+        queue.byDeadline.erase({job.deadline().value_or(Clock::TimePoint::max()), sequence});
+        queue.byArrival.erase(it);
+        --size_;
+
+        auto& stats = stats_[chosen];
+        ++stats.served;
+        stats.totalWait += waited;
+        stats.maxWait = std::max(stats.maxWait, waited);
+        if (job.deadline() && now > *job.deadline()) {
+            ++stats.missedDeadlines;
+        }
+        return job;
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Job.hpp"
+#include "Clock.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+
+namespace Factory {
+
+    // Simulated time (milliseconds) a waiting job needs to be promoted by one priority class
+    inline constexpr int JOB_AGING_MS = 5000;
+
+    // Queue wait of the jobs of one priority class, measured from enqueue to start
+    struct QueueWaitStats {
+        size_t served{0};
+        size_t missedDeadlines{0}; // started after their deadline
+        Clock::Duration totalWait{};
+        Clock::Duration maxWait{};
+
+        Clock::Duration MeanWait() const noexcept {
+            return served == 0 ? Clock::Duration::zero() : totalWait / static_cast<Clock::Duration::rep>(served);
+        }
+    };
+
+    /**
+     * Pending jobs, served by priority class and, within a class, earliest deadline first
+     * (jobs without a deadline last, then in arrival order).
+     * To prevent starvation, the oldest job of a class is promoted by one class for every
+     * `aging` it has waited; a promoted job is served ahead of the class it caught up with.
+     * Not synchronized; the Controller guards it with its queue lock.
+     */
+    class JobQueue {
+    public:
+        explicit JobQueue(Clock::Duration aging = std::chrono::milliseconds(JOB_AGING_MS)) noexcept
+            : aging_(aging) {}
+
+        /** @throws std::bad_alloc
+         * Exception guarantee: strong
+         */
+        void Push(Job job, Clock::TimePoint now);
+
+        // Removes the next job to serve and records its queue wait
+        std::optional<Job> Pop(Clock::TimePoint now);
+
+        bool Empty() const noexcept { return size_ == 0; }
+
+        size_t Size() const noexcept { return size_; }
+
+        const std::array<QueueWaitStats, JOB_PRIORITY_COUNT>& WaitStats() const noexcept { return stats_; }
+
+    private:
+        struct Entry {
+            Job job;
+            Clock::TimePoint enqueuedAt;
+        };
+
+        // Per class: entries by arrival (oldest first) and an index ordered by (deadline, arrival)
+        struct ClassQueue {
+            std::map<std::uint64_t, Entry> byArrival;
+            std::set<std::pair<Clock::TimePoint, std::uint64_t>> byDeadline;
+        };
+
+        Clock::Duration aging_;
+        std::array<ClassQueue, JOB_PRIORITY_COUNT> classes_;
+        std::array<QueueWaitStats, JOB_PRIORITY_COUNT> stats_{};
+        std::uint64_t nextSequence_{0};
+        size_t size_{0};
+    };
+}
@@ -0,0 +1,132 @@
+#include "Logger.hpp"
+
+#include <iostream>
+
+namespace Factory::Logging {
+
+    namespace {
+        // Marks the thread's ring as orphaned on thread exit so the drain thread can drop it
+        struct LocalRingHolder {
+            std::shared_ptr<detail::Ring> ring;
+
+            ~LocalRingHolder() {
+                if (ring) {
+                    ring->orphaned.store(true, std::memory_order_release);
+                }
+            }
+        };
+
+        std::ostream& StreamFor(Level level) {
+            return level >= Level::Error ? std::cerr : std::cout;
+        }
+    }
+
+    Logger& Logger::Instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger::Logger() {
+        running_.store(true);
+        drainThread_ = std::thread(&Logger::DrainLoop, this);
+    }
+
+    Logger::~Logger() {
+        {
+            std::lock_guard<std::mutex> lock(drainMutex_);
+            running_.store(false, std::memory_order_release);
+        }
+        drainCV_.notify_all();
+        if (drainThread_.joinable()) {
+            drainThread_.join();
+        }
+        DrainOnce();
+    }
+
+    void Logger::Flush() {
+        DrainOnce();
+    }
+
+    detail::Ring* Logger::LocalRing() noexcept {
+        thread_local LocalRingHolder holder;
+        if (!holder.ring) {
+            if (!running_.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+            try {
+                auto ring = std::make_shared<detail::Ring>();
+                std::lock_guard<std::mutex> lock(registryMutex_);
+                rings_.push_back(ring);
+                holder.ring = std::move(ring);
+            } catch (...) {
+                return nullptr; // out of memory: caller falls back to synchronous output
+            }
+        }
+        return holder.ring.get();
+    }
+
+    void Logger::WriteDirect(const detail::Record& record) noexcept {
+        try {
+            auto& os = StreamFor(record.level);
+            record.decode(os, record.payload.data());
+            os << std::endl;
+        } catch (...) {
+            // Logging must never take down the caller
+        }
+    }
+
+    size_t Logger::DrainOnce() {
+        std::lock_guard<std::mutex> drainLock(drainMutex_);
+        std::lock_guard<std::mutex> registryLock(registryMutex_);
+
+        std::vector<const detail::Record*> records;
+        std::vector<size_t> counts(rings_.size());
+        for (size_t i = 0; i < rings_.size(); ++i) {
+            counts[i] = rings_[i]->Collect(records);
+        }
+
+        // Restore cross-thread order before formatting
+        std::stable_sort(records.begin(), records.end(), [](const auto* a, const auto* b) {
+            return a->timestamp < b->timestamp;
+        });
+
+        bool wroteError = false;
+        for (const auto* record : records) {
+            try {
+                auto& os = StreamFor(record->level);
+                record->decode(os, record->payload.data());
+                os << '\n';
+                wroteError = wroteError || record->level >= Level::Error;
+            } catch (...) {
+                // Skip records that fail to format
+            }
+        }
+        if (!records.empty()) {
+            std::cout.flush();
+            if (wroteError) {
+                std::cerr.flush();
+            }
+        }
+
+        for (size_t i = 0; i < rings_.size(); ++i) {
+            rings_[i]->Release(counts[i]);
+        }
+        std::erase_if(rings_, [](const auto& ring) {
+            return ring->orphaned.load(std::memory_order_acquire) && ring->Empty();
+        });
+
+        return records.size();
+    }
+
+    void Logger::DrainLoop() {
+        while (running_.load(std::memory_order_acquire)) {
+            if (DrainOnce() > 0) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(drainMutex_);
+            drainCV_.wait_for(lock, std::chrono::milliseconds(1), [this] {
+                return !running_.load(std::memory_order_acquire);
+            });
+        }
+    }
+}
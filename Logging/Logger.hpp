@@ -0,0 +1,284 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Minimum level compiled into the binary: 0=Debug, 1=Info, 2=Warn, 3=Error, 4=Off.
+// Calls below this level are removed entirely, including evaluation of their arguments.
+#ifndef FACTORY_LOG_LEVEL
+#define FACTORY_LOG_LEVEL 1
+#endif
+
+namespace Factory::Logging {
+
+    enum class Level : std::uint8_t {
+        Debug = 0,
+        Info = 1,
+        Warn = 2,
+        Error = 3,
+        Off = 4,
+    };
+
+    inline constexpr Level COMPILE_TIME_LEVEL = static_cast<Level>(FACTORY_LOG_LEVEL);
+
+    constexpr bool IsEnabled(Level level) noexcept {
+        return level >= COMPILE_TIME_LEVEL && level != Level::Off;
+    }
+
+    namespace detail {
+        inline constexpr size_t PAYLOAD_SIZE = 232;
+        inline constexpr size_t RING_CAPACITY = 1024; // records per thread, power of two
+
+        class Writer {
+        public:
+            explicit Writer(std::byte* out) noexcept : out_(out) {}
+
+            bool Put(const void* src, size_t n) noexcept {
+                if (n > Remaining()) {
+                    return false;
+                }
+                std::memcpy(out_ + used_, src, n);
+                used_ += n;
+                return true;
+            }
+
+            size_t Remaining() const noexcept { return PAYLOAD_SIZE - used_; }
+
+        private:
+            std::byte* out_;
+            size_t used_{0};
+        };
+
+        class Reader {
+        public:
+            explicit Reader(const std::byte* in) noexcept : in_(in) {}
+
+            void Get(void* dst, size_t n) noexcept {
+                std::memcpy(dst, in_ + used_, n);
+                used_ += n;
+            }
+
+            const char* Skip(size_t n) noexcept {
+                auto* p = reinterpret_cast<const char*>(in_ + used_);
+                used_ += n;
+                return p;
+            }
+
+        private:
+            const std::byte* in_;
+            size_t used_{0};
+        };
+
+        // Trivially copyable arguments (integers, floats, enums) are stored as raw bytes
+        template<class T>
+        struct ValueCodec {
+            static bool Encode(Writer& w, const T& value) noexcept {
+                return w.Put(&value, sizeof(T));
+            }
+
+            static void Decode(Reader& r, std::ostream& os) {
+                T value;
+                r.Get(&value, sizeof(T));
+                if constexpr (std::is_enum_v<T>) {
+                    os << static_cast<std::underlying_type_t<T>>(value);
+                } else {
+                    os << value;
+                }
+            }
+        };
+
+        // Strings are copied (length-prefixed, truncated to the remaining payload) so the
+        // record never points into memory owned by the logging thread
+        struct StringCodec {
+            static bool Encode(Writer& w, std::string_view value) noexcept {
+                if (w.Remaining() < sizeof(std::uint16_t)) {
+                    return false;
+                }
+                auto len = static_cast<std::uint16_t>(
+                    std::min(value.size(), w.Remaining() - sizeof(std::uint16_t)));
+                w.Put(&len, sizeof(len));
+                w.Put(value.data(), len);
+                return true;
+            }
+
+            static void Decode(Reader& r, std::ostream& os) {
+                std::uint16_t len;
+                r.Get(&len, sizeof(len));
+                os.write(r.Skip(len), len);
+            }
+        };
+
+        template<class T>
+        inline constexpr bool is_string_like_v =
+            std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view> ||
+            std::is_same_v<T, const char*> || std::is_same_v<T, char*>;
+
+        template<class T>
+        using CodecFor = std::conditional_t<is_string_like_v<T>, StringCodec, ValueCodec<T>>;
+
+        template<class T>
+        using Stored = std::decay_t<const T&>;
+
+        template<class... Args>
+        void DecodePayload(std::ostream& os, const std::byte* payload) {
+            Reader reader(payload);
+            std::uint8_t count;
+            reader.Get(&count, sizeof(count));
+            std::uint8_t index = 0;
+            ((index++ < count ? CodecFor<Args>::Decode(reader, os) : void()), ...);
+        }
+
+        template<class... Args>
+        void EncodePayload(std::byte* payload, const Args&... args) noexcept {
+            static_assert(((is_string_like_v<Args> || std::is_trivially_copyable_v<Args>) && ...),
+                          "log arguments must be strings or trivially copyable values");
+            Writer writer(payload + 1);
+            std::uint8_t count = 0;
+            bool fits = true;
+            ((fits = fits && CodecFor<Args>::Encode(writer, args), count += fits), ...);
+            std::memcpy(payload, &count, sizeof(count));
+        }
+
+        struct Record {
+            using Decoder = void (*)(std::ostream&, const std::byte*);
+
+            Decoder decode;
+            std::uint64_t timestamp;
+            Level level;
+            std::array<std::byte, PAYLOAD_SIZE + 1> payload;
+        };
+
+        // Single-producer (owning thread) / single-consumer (drain thread) ring buffer
+        class Ring {
+        public:
+            Record* TryClaim() noexcept {
+                auto tail = tail_.load(std::memory_order_relaxed);
+                if (tail - head_.load(std::memory_order_acquire) == RING_CAPACITY) {
+                    return nullptr;
+                }
+                return &slots_[tail & (RING_CAPACITY - 1)];
+            }
+
+            void Commit() noexcept {
+                tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            // Consumer side: exposes all committed records without releasing them
+            size_t Collect(std::vector<const Record*>& out) const {
+                auto head = head_.load(std::memory_order_relaxed);
+                auto tail = tail_.load(std::memory_order_acquire);
+                for (auto i = head; i != tail; ++i) {
+                    out.push_back(&slots_[i & (RING_CAPACITY - 1)]);
+                }
+                return tail - head;
+            }
+
+            // Consumer side: hands the first `count` collected slots back to the producer
+            void Release(size_t count) noexcept {
+                head_.store(head_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+            }
+
+            bool Empty() const noexcept {
+                return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+            }
+
+            std::atomic_bool orphaned{false}; // owning thread has exited
+
+        private:
+            std::array<Record, RING_CAPACITY> slots_;
+            alignas(64) std::atomic<size_t> head_{0};
+            alignas(64) std::atomic<size_t> tail_{0};
+        };
+    }
+
+    /**
+     * Asynchronous logger.
+     * Each logging thread writes binary-encoded records into its own lock-free ring;
+     * a background thread drains all rings, restores cross-thread order by timestamp and
+     * formats the records to stdout (stderr for errors) with one flush per batch.
+     */
+    class Logger {
+    public:
+        static Logger& Instance();
+
+        ~Logger();
+
+        Logger(const Logger&) = delete;
+        Logger& operator=(const Logger&) = delete;
+
+        template<class... Args>
+        void Write(Level level, const Args&... args) noexcept {
+            detail::Record* record = nullptr;
+            detail::Ring* ring = LocalRing();
+            while (ring != nullptr && (record = ring->TryClaim()) == nullptr) {
+                if (!running_.load(std::memory_order_acquire)) {
+                    break;
+                }
+                std::this_thread::yield(); // ring full: wait for the drain thread
+            }
+
+            detail::Record local;
+            detail::Record& r = record != nullptr ? *record : local;
+            r.decode = &detail::DecodePayload<detail::Stored<Args>...>;
+            r.timestamp = Timestamp();
+            r.level = level;
+            detail::EncodePayload<detail::Stored<Args>...>(r.payload.data(), args...);
+
+            if (record != nullptr) {
+                ring->Commit();
+            } else {
+                WriteDirect(r); // drain thread unavailable: format synchronously
+            }
+        }
+
+        /** Blocks until every record written before the call has been printed. */
+        void Flush();
+
+    private:
+        Logger();
+
+        static std::uint64_t Timestamp() noexcept {
+            return static_cast<std::uint64_t>(
+                std::chrono::steady_clock::now().time_since_epoch().count());
+        }
+
+        detail::Ring* LocalRing() noexcept;
+        void WriteDirect(const detail::Record& record) noexcept;
+        size_t DrainOnce();
+        void DrainLoop();
+
+        std::mutex registryMutex_;
+        std::vector<std::shared_ptr<detail::Ring>> rings_;
+
+        std::mutex drainMutex_;
+        std::condition_variable drainCV_;
+        std::thread drainThread_;
+        std::atomic_bool running_{false};
+    };
+}
+
+#define FACTORY_LOG(level, ...)                                                   \
+    do {                                                                          \
+        if constexpr (::Factory::Logging::IsEnabled(level)) {                     \
+            ::Factory::Logging::Logger::Instance().Write(level, __VA_ARGS__);     \
+        }                                                                         \
+    } while (0)
+
+#define FACTORY_LOG_DEBUG(...) FACTORY_LOG(::Factory::Logging::Level::Debug, __VA_ARGS__)
+#define FACTORY_LOG_INFO(...) FACTORY_LOG(::Factory::Logging::Level::Info, __VA_ARGS__)
+#define FACTORY_LOG_WARN(...) FACTORY_LOG(::Factory::Logging::Level::Warn, __VA_ARGS__)
+#define FACTORY_LOG_ERROR(...) FACTORY_LOG(::Factory::Logging::Level::Error, __VA_ARGS__)
@@ -0,0 +1,43 @@
+#pragma once
+#include "MachineBase.hpp"
+#include "../../Shared.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+namespace Factory::Machinery {
+    /**
+     * Outbound end of the line: takes finished materials of any kind and ships them out of
+     * the factory, freeing their payloads. Keeps a count per kind.
+     */
+    class Dock : public MachineBase {
+    public:
+        using MachineBase::MachineBase;
+
+        /**
+         * @throws std::invalid_argument for an empty handle or an invalid kind
+         * Exception guarantee: strong
+         */
+        void TryReceive(Data::MaterialHandle&& material) override {
+            if (!CanAccept(material.Kind())) {
+                throw std::invalid_argument("[DOCK] cannot ship an invalid material");
+            }
+            const Data::MaterialHandle shipped = std::move(material);
+            shipped_[static_cast<size_t>(shipped.Kind())].fetch_add(1);
+            FACTORY_LOG_INFO("[DOCK] ", Name(), " shipped material_kind=", Data::toString(shipped.Kind()));
+        }
+
+        bool CanAccept(Data::MaterialKind kind) const noexcept override {
+            return static_cast<size_t>(kind) < Data::MATERIAL_KIND_COUNT;
+        }
+
+        std::uint64_t Shipped(Data::MaterialKind kind) const {
+            return shipped_.at(static_cast<size_t>(kind)).load();
+        }
+
+    private:
+        std::array<std::atomic<std::uint64_t>, Data::MATERIAL_KIND_COUNT> shipped_{};
+    };
+}
@@ -0,0 +1,60 @@
+#include "FactoryLayout.hpp"
+
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace Factory::Machinery {
+
+    void FactoryLayout::Place(MachineId machine, Position at) {
+        if (machine == UNASSIGNED_MACHINE_ID) {
+            throw std::invalid_argument("[LAYOUT] only registered machines can be placed");
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        positions_[machine] = at;
+    }
+
+    void FactoryLayout::SetDistance(MachineId a, MachineId b, double meters) {
+        if (a == UNASSIGNED_MACHINE_ID || b == UNASSIGNED_MACHINE_ID) {
+            throw std::invalid_argument("[LAYOUT] distances need registered machines");
+        }
+        if (!(meters >= 0.0)) {
+            throw std::invalid_argument("[LAYOUT] distance must be a non-negative number of meters");
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        distances_[PairKey(a, b)] = meters;
+    }
+
+    std::optional<Position> FactoryLayout::PositionOf(MachineId machine) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        const auto it = positions_.find(machine);
+        if (it == positions_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    std::optional<double> FactoryLayout::Distance(MachineId from, MachineId to) const {
+        if (from == to) {
+            return 0.0;
+        }
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (const auto it = distances_.find(PairKey(from, to)); it != distances_.end()) {
+            return it->second;
+        }
+        const auto a = positions_.find(from);
+        const auto b = positions_.find(to);
+        if (a == positions_.end() || b == positions_.end()) {
+            return std::nullopt;
+        }
+        return std::hypot(a->second.x - b->second.x, a->second.y - b->second.y);
+    }
+
+    std::uint64_t FactoryLayout::PairKey(MachineId a, MachineId b) noexcept {
+        if (b < a) {
+            std::swap(a, b);
+        }
+        return static_cast<std::uint64_t>(a) << 32 | b;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "MachineBase.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace Factory::Machinery {
+
+    // Where a machine stands on the shop floor, in meters
+    struct Position {
+        double x{0.0};
+        double y{0.0};
+    };
+
+    /**
+     * Floor plan of a factory: machine positions, plus measured distances for pairs whose
+     * route is not a straight line (around a wall, through a door). Movers derive their
+     * travel times from it.
+     * Written while machines are registered and read by every mover, so access is locked.
+     */
+    class FactoryLayout {
+    public:
+        /** Places a machine, or moves it if it was placed before.
+         * @throws std::invalid_argument if the machine has no id yet
+         * @throws std::bad_alloc
+         * Exception guarantee: strong
+         */
+        void Place(MachineId machine, Position at);
+
+        /** Overrides the distance between two machines in both directions.
+         * @throws std::invalid_argument if either machine has no id yet or meters is negative
+         * @throws std::bad_alloc
+         * Exception guarantee: strong
+         */
+        void SetDistance(MachineId a, MachineId b, double meters);
+
+        std::optional<Position> PositionOf(MachineId machine) const;
+
+        // Route length between two machines: the override if one is set, else the straight
+        // line between their positions; std::nullopt if neither is known
+        std::optional<double> Distance(MachineId from, MachineId to) const;
+
+    private:
+        static std::uint64_t PairKey(MachineId a, MachineId b) noexcept;
+
+        mutable std::shared_mutex mutex_;
+        std::unordered_map<MachineId, Position> positions_;
+        std::unordered_map<std::uint64_t, double> distances_;
+    };
+}
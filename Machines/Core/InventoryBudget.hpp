@@ -0,0 +1,108 @@
+#pragma once
+
+#include "../../Materials/AnyMaterial.hpp"
+
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+namespace Factory::Machinery {
+
+    inline constexpr size_t UNBOUNDED = std::numeric_limits<size_t>::max();
+
+    /**
+     * Capacity and throttling band for one material kind at one machine.
+     * Once occupancy (stored + reserved) reaches highWatermark the kind is throttled
+     * and stays throttled until occupancy falls back to lowWatermark.
+     */
+    struct InventoryLimit {
+        size_t capacity{UNBOUNDED};
+        size_t highWatermark{UNBOUNDED};
+        size_t lowWatermark{UNBOUNDED};
+    };
+
+    // Snapshot of one kind's inventory at a machine
+    struct Occupancy {
+        Data::MaterialKind kind;
+        size_t stored;
+        size_t reserved;
+        size_t capacity;
+        bool throttled;
+    };
+
+    // Occupancy accounting for one kind; not synchronized, guard with the machine's inventory lock
+    class InventoryBudget {
+    public:
+        /** @throws std::invalid_argument unless lowWatermark <= highWatermark <= capacity */
+        void SetLimit(const InventoryLimit& limit) {
+            if (limit.lowWatermark > limit.highWatermark || limit.highWatermark > limit.capacity) {
+                throw std::invalid_argument("inventory limit requires lowWatermark <= highWatermark <= capacity");
+            }
+            limit_ = limit;
+            Update();
+        }
+
+        // Claims room for one inbound item; fails while throttled or full
+        bool TryReserve() noexcept {
+            if (!HasSpace()) {
+                return false;
+            }
+            ++reserved_;
+            Update();
+            return true;
+        }
+
+        void ReleaseReservation() noexcept {
+            if (reserved_ > 0) {
+                --reserved_;
+                Update();
+            }
+        }
+
+        // Stores one item, consuming a reservation if one is outstanding
+        void Add() noexcept {
+            if (reserved_ > 0) {
+                --reserved_;
+            }
+            ++stored_;
+            Update();
+        }
+
+        void Remove() noexcept {
+            if (stored_ > 0) {
+                --stored_;
+                Update();
+            }
+        }
+
+        bool HasSpace() const noexcept { return !throttled_ && stored_ + reserved_ < limit_.capacity; }
+
+        bool Full() const noexcept { return stored_ + reserved_ >= limit_.capacity; }
+
+        // Items that can still be stored before the kind is full; throttling does not count
+        size_t Room() const noexcept { return Full() ? 0 : limit_.capacity - stored_ - reserved_; }
+
+        bool Throttled() const noexcept { return throttled_; }
+
+        size_t Stored() const noexcept { return stored_; }
+
+        Occupancy Snapshot(Data::MaterialKind kind) const noexcept {
+            return Occupancy{kind, stored_, reserved_, limit_.capacity, throttled_};
+        }
+
+    private:
+        void Update() noexcept {
+            const size_t occupancy = stored_ + reserved_;
+            if (occupancy >= limit_.highWatermark) {
+                throttled_ = true;
+            } else if (occupancy <= limit_.lowWatermark) {
+                throttled_ = false;
+            }
+        }
+
+        InventoryLimit limit_;
+        size_t stored_{0};
+        size_t reserved_{0};
+        bool throttled_{false};
+    };
+}
@@ -1,41 +1,71 @@
 #pragma once
 
 #include "../../Materials/AnyMaterial.hpp"
+#include "../../Materials/MaterialArena.hpp"
+#include "../../Concurrency/MpscQueue.hpp"
+#include "MaterialWaiters.hpp"
+#include "InventoryBudget.hpp"
+#include "../../Metrics/MachineMetrics.hpp"
 
 #include <atomic>
-#include <condition_variable>
-#include <mutex>
+#include <cstdint>
 #include <optional>
-#include <queue>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
 #include <variant>
-#include <iostream>
-#include <future>
+#include <functional>
 #include "../../Shared.hpp"
+#include "../../Clock.hpp"
+#include "../../Logging/Logger.hpp"
+#include "../../Tracing/Tracer.hpp"
 
 namespace Factory::Machinery {
 
     class MachineBase;
 
+    // Dense per-controller machine identifier, assigned on registration
+    using MachineId = std::uint32_t;
+    inline constexpr MachineId UNASSIGNED_MACHINE_ID = static_cast<MachineId>(-1);
+
+    // Invoked on the machine's worker thread once a command has finished
+    using Completion = std::function<void(StepStatus)>;
+
     struct TransportCommand {
         Data::MaterialKind material_kind;
         MachineBase& source;
         MachineBase& destination;
-        std::promise<StepStatus> &cmdCompleted;
+        Completion onCompleted;
+        Clock::TimePoint enqueuedAt{}; // stamped by EnqueueCommand
     };
 
     struct ProcessCommand {
         Data::MaterialKind material_kind;
-        std::promise<StepStatus> &cmdCompleted;
+        Completion onCompleted;
+        size_t maxItems{1}; // batch command: process up to this many items in one cycle
+        Clock::TimePoint enqueuedAt{};
     };
 
     struct GenerateResourceCommand {
         Data::MaterialKind material_kind;
+        Completion onCompleted{};
+        Clock::TimePoint enqueuedAt{};
     };
 
     using Command = std::variant<TransportCommand, ProcessCommand, GenerateResourceCommand>;
 
+    /**
+     * Told about every item entering (+1) or leaving (-1) a machine's inventory, e.g. to journal
+     * stock levels. Runs on the thread that moved the item, possibly under the machine's
+     * inventory lock, so it must be cheap and must not call back into the machine.
+     */
+    class InventoryObserver {
+    public:
+        virtual ~InventoryObserver() = default;
+        virtual void OnStockChanged(MachineId machine, Data::MaterialKind kind, int delta) noexcept = 0;
+    };
+
     class MachineBase {
     public:
         explicit MachineBase(std::string name) noexcept
@@ -53,28 +83,104 @@ namespace Factory::Machinery {
 
         std::string_view Name() const noexcept { return name_; };
 
+        MachineId Id() const noexcept { return id_; }
+
+        // Assigned by the owning Controller when the machine is registered
+        void SetId(MachineId id) noexcept { id_ = id; }
+
+        /** Sets the clock used for all simulated delays of this machine.
+         * Must be called before StartThread().
+         */
+        void SetClock(Clock& clock) noexcept { clock_ = &clock; }
+
+        // Reports later inventory changes to `observer`; nullptr stops reporting
+        void SetInventoryObserver(InventoryObserver* observer) noexcept { inventoryObserver_.store(observer); }
+
+        /**
+         * Puts items back into inventory after a restart, e.g. from a replayed journal.
+         * The items get fresh payloads and are not reported to the inventory observer.
+         * Override in machines that hold materials.
+         * @throws std::invalid_argument if this machine does not stock the kind
+         * @throws std::bad_alloc
+         * Exception guarantee: basic
+         * Items put back before a throw stay in inventory.
+         */
+        virtual void Restock(Data::MaterialKind kind, size_t /*count*/) {
+            throw std::invalid_argument("[MACHINE] " + name_ + " does not stock " + Data::toString(kind));
+        }
+
         /**
-         * Attempts to deliver material to this machine.
+         * Attempts to deliver material to this machine, which takes over the handle.
          * @throws std::invalid_argument if material type is not compatible
          * @param material
          * Exception guarantee: strong
-         * No changes to inventory on throws.
+         * No changes to inventory on throws; the caller keeps the handle.
          */
-        virtual void TryReceive(Data::AnyMaterial&& material) = 0;
+        virtual void TryReceive(Data::MaterialHandle&& material) = 0;
         virtual bool CanAccept(Data::MaterialKind kind) const noexcept = 0;
 
         /**
          * Attempts to take a material of the specified kind from this machine.
          * Override in machines that can provide materials (e.g., ResourceStation).
-         * @return The material if available, std::nullopt otherwise
+         * @return The handle of the material if available, an empty handle otherwise
          */
-        virtual std::optional<Data::AnyMaterial> TakeMaterial(Data::MaterialKind) {
-            return std::nullopt;
+        virtual Data::MaterialHandle TakeMaterial(Data::MaterialKind) {
+            return {};
+        }
+
+        /**
+         * Subscribes to material of the given kind becoming available at this machine,
+         * i.e. takeable via TakeMaterial or, for producers, ready to be processed.
+         * Fires the subscription right away if the material is already there.
+         * Override in machines that hold materials.
+         * @return false if this machine does not support availability notifications
+         * @throws std::bad_alloc
+         */
+        virtual bool NotifyWhenAvailable(Data::MaterialKind, const MaterialWaitPtr&) {
+            return false;
+        }
+
+        /**
+         * Reserves room for one inbound item of the given kind before a transport picks it up.
+         * The reservation is consumed by TryReceive or returned via ReleaseReservation.
+         * Machines without inventory limits always succeed.
+         * @return false if the kind is at capacity or throttled
+         */
+        virtual bool ReserveSpace(Data::MaterialKind) { return true; }
+
+        virtual void ReleaseReservation(Data::MaterialKind) noexcept {}
+
+        /**
+         * Subscribes to room for one more item of the given kind becoming free at this machine.
+         * Fires the subscription right away if there is room already.
+         * @return false if this machine does not support space notifications
+         * @throws std::bad_alloc
+         */
+        virtual bool NotifyWhenSpace(Data::MaterialKind, const MaterialWaitPtr&) {
+            return false;
+        }
+
+        // Commands enqueued or in service; used to pick the least-loaded machine of a pool
+        size_t QueueDepth() const noexcept { return queueDepth_.load(std::memory_order_relaxed); }
+
+        // Per-kind inventory occupancy, for sizing buffers
+        virtual std::vector<Occupancy> GetOccupancy() const { return {}; }
+
+        /** Queue, latency, outcome and utilization metrics recorded since the machine was created.
+         *
+         * @throws std::bad_alloc
+         */
+        Metrics::MachineMetricsSnapshot GetMetrics() const {
+            auto snapshot = metrics_.Snapshot();
+            snapshot.name = name_;
+            snapshot.queueDepth = QueueDepth();
+            snapshot.occupancy = GetOccupancy();
+            return snapshot;
         }
 
         void EmergencyStop() noexcept{
             shouldStop_.store(true);
-            workCondition_.notify_all();
+            workQueue_.Notify();
         }
 
         void DoMaintenance() {
@@ -110,49 +216,122 @@ namespace Factory::Machinery {
                 return;
             }
             shouldStop_.store(true);
-            workCondition_.notify_all();
+            workQueue_.Notify();
             if (workerThread_.joinable()) {
                 try {
                     workerThread_.join();
                 } catch (...) {
-                    std::cerr << "[ERROR] Failed to join worker thread for machine: " << Name() << std::endl;
+                    FACTORY_LOG_ERROR("[ERROR] Failed to join worker thread for machine: ", Name());
                 }
 
             }
         }
         /** Enqueues a command for processing by the internal worker thread.
+         * Lock-free: any number of threads may enqueue concurrently.
          *
          * @throws std::exception on enqueue failure
          * Exception guarantee: strong
          * No changes to work queue on throws.
          */
-        void EnqueueCommand(Command const &cmd) {
+        void EnqueueCommand(Command cmd) {
             try {
                 std::visit([this](const auto& c) {
                 using C = std::decay_t<decltype(c)>;
                 if constexpr (std::is_same_v<C, TransportCommand>) {
-                    std::cout << "[MOVER] " << Name() << " enqueued transport command" << std::endl;
+                    FACTORY_LOG_INFO("[MOVER] ", Name(), " enqueued transport command");
                 } else if constexpr (std::is_same_v<C, ProcessCommand>) {
-                    std::cout << "[PRODUCER] " << Name() << " enqueued process command" << std::endl;
+                    FACTORY_LOG_INFO("[PRODUCER] ", Name(), " enqueued process command");
                 }
             }, cmd);
             } catch (...) {
-                std::cout << "[MACHINE] Failed to deduce machine type proceeding to enqueue command" << std::endl;
+                FACTORY_LOG_INFO("[MACHINE] Failed to deduce machine type proceeding to enqueue command");
             }
-            {
-                try {
-                    std::lock_guard<std::mutex> lock(workMutex_);
-                    workQueue_.push(cmd);
-                } catch (std::exception &e) {
-                    std::cerr << "[ERROR] Failed to enqueue command with error: " << e.what() << std::endl;
-                    throw;
+            std::visit([this](auto& c) { Admit(c); }, cmd);
+            try {
+                if (DivertCommand(cmd)) {
+                    return;
                 }
-
+                workQueue_.Push(std::move(cmd));
+            } catch (std::exception &e) {
+                Retract();
+                FACTORY_LOG_ERROR("[ERROR] Failed to enqueue command with error: ", e.what());
+                throw;
             }
-            workCondition_.notify_one();
         }
 
     protected:
+        Clock& GetClock() const noexcept { return *clock_; }
+
+        /** Stamps a command as enqueued and counts it towards QueueDepth() until FinishCommand.
+         * Exception guarantee: strong
+         */
+        template<class C>
+        void Admit(C& c) {
+            c.enqueuedAt = clock_->Now();
+            FACTORY_TRACE(Instant, "command", std::string("enqueue ") + Metrics::toString(CommandTypeOf<C>()),
+                          {{"machine", name_}, {"material", Data::toString(c.material_kind)}});
+            metrics_.RecordQueueDepth(queueDepth_.fetch_add(1, std::memory_order_relaxed) + 1);
+        }
+
+        // Undoes Admit for a command that could not be queued after all
+        void Retract() noexcept { queueDepth_.fetch_sub(1, std::memory_order_relaxed); }
+
+        // Forwards an inventory change of this machine to the observer, if any
+        void ReportStock(Data::MaterialKind kind, int delta) const noexcept {
+            if (auto* observer = inventoryObserver_.load(std::memory_order_acquire)) {
+                observer->OnStockChanged(id_, kind, delta);
+            }
+        }
+
+        // Wakes the worker thread so it re-checks HasPendingWork()
+        void Wake() noexcept { workQueue_.Notify(); }
+
+        /** Hook to take over an enqueued command instead of queueing it, e.g. to share it with a pool.
+         * A diverted command still counts towards QueueDepth() until RunProcessCommand finishes it.
+         * @return true if the command was taken over
+         * Exception guarantee: strong
+         */
+        virtual bool DivertCommand(Command&) { return false; }
+
+        // Work held outside the command queue; polled by the worker whenever it looks for work.
+        // Must be cheap and thread-safe.
+        virtual bool HasPendingWork() const noexcept { return false; }
+
+        // Runs one unit of that work on the worker thread
+        virtual void RunPendingWork() {}
+
+        // Executes a process command on the calling worker thread and reports its completion
+        void RunProcessCommand(const ProcessCommand& c) {
+            FACTORY_LOG_INFO("[PRODUCER] ", name_, " picking up process command from queue");
+            const auto started = clock_->Now();
+            StepStatus success;
+            try {
+                success = OnProcess(c);
+            } catch (std::exception &e) {
+                FACTORY_LOG_ERROR("[ERROR] Failed to execute the process command with error: ", e.what());
+                success = ERROR;
+            }
+            FinishCommand(c, started, success);
+        }
+
+        /** Reports a command taken from the queue (or diverted) as finished: records its wait
+         * and service time, then runs its completion.
+         * @param started when service of the command (or its batch) began
+         */
+        template<class C>
+        void FinishCommand(const C& c, Clock::TimePoint started, StepStatus status) noexcept {
+            const auto finished = clock_->Now();
+            metrics_.RecordCommand(CommandTypeOf<C>(), started - c.enqueuedAt, finished - started, status);
+            TraceCommand(c, started, finished, status);
+            queueDepth_.fetch_sub(1, std::memory_order_relaxed);
+            Complete(c.onCompleted, status);
+        }
+
+        // Moves one unit of queue depth to another machine that takes over a diverted command
+        void TransferQueueDepth(MachineBase& to) noexcept {
+            queueDepth_.fetch_sub(1, std::memory_order_relaxed);
+            to.metrics_.RecordQueueDepth(to.queueDepth_.fetch_add(1, std::memory_order_relaxed) + 1);
+        }
 
         /** Override to handle transport commands.
          *
@@ -183,64 +362,122 @@ namespace Factory::Machinery {
         virtual StepStatus OnGenerate(const GenerateResourceCommand&) {return ERROR;}
 
     private:
+        template<class C>
+        static constexpr Metrics::CommandType CommandTypeOf() noexcept {
+            if constexpr (std::is_same_v<C, TransportCommand>) {
+                return Metrics::CommandType::Transport;
+            } else if constexpr (std::is_same_v<C, ProcessCommand>) {
+                return Metrics::CommandType::Process;
+            } else {
+                static_assert(std::is_same_v<C, GenerateResourceCommand>, "unknown command type");
+                return Metrics::CommandType::Generate;
+            }
+        }
+
+        // Records the command's queue wait (enqueue to pickup) and its service span on this thread
+        template<class C>
+        void TraceCommand(const C& c, Clock::TimePoint started, Clock::TimePoint finished, StepStatus status) noexcept {
+            if (!Tracing::Tracer::Instance().Enabled()) {
+                return;
+            }
+            try {
+                auto& tracer = Tracing::Tracer::Instance();
+                const char* type = Metrics::toString(CommandTypeOf<C>());
+                const std::string id = name_ + "#" + std::to_string(traceSequence_++);
+                const std::string queued = std::string("queued ") + type;
+                tracer.AsyncBegin("queue", queued, id, c.enqueuedAt, {{"machine", name_}});
+                tracer.AsyncEnd("queue", queued, id, started, {});
+                Tracing::Args args{{"machine", name_}, {"material", Data::toString(c.material_kind)},
+                                   {"status", Metrics::toString(status)}};
+                if constexpr (std::is_same_v<C, TransportCommand>) {
+                    args.push_back({"source", std::string(c.source.Name())});
+                    args.push_back({"destination", std::string(c.destination.Name())});
+                }
+                tracer.Complete("machine", type, started, finished, std::move(args));
+            } catch (...) {
+                // Tracing must never fail a command
+            }
+        }
+
+        static void Complete(const Completion& onCompleted, StepStatus status) noexcept {
+            if (!onCompleted) {
+                return;
+            }
+            try {
+                onCompleted(status);
+            } catch (std::exception &e) {
+                FACTORY_LOG_ERROR("[ERROR] Completion handler failed with error: ", e.what());
+            }
+        }
+
         /** Internal worker loop processing commands from the queue.
+         * Spins briefly when the queue runs dry, then parks until the next enqueue or Wake().
+         * Pending work outside the queue (see HasPendingWork) is served before queued commands.
+         * Time spent waiting for work and time spent on it feed the utilization metric.
          *
          * Exception guarantee: Basic
-         * Commands may be lost if the unique_lock throws on unlock.
+         * Commands still queued when the machine stops stay queued until the next StartThread().
          */
         void WorkerLoop() {
-            while (!shouldStop_.load()) {
-                std::unique_lock<std::mutex> lock(workMutex_);
-                workCondition_.wait(lock, [this] {
-                    return shouldStop_.load() || !workQueue_.empty();
-                });
-                if (shouldStop_.load()) {
-                    break;
+            FACTORY_TRACE(SetThreadName, name_);
+            while (true) {
+                const auto idleSince = clock_->Now();
+                auto next = workQueue_.WaitPop([this] { return shouldStop_.load() || HasPendingWork(); });
+                const auto started = clock_->Now();
+                metrics_.RecordIdle(started - idleSince);
+                if (!next) {
+                    if (shouldStop_.load()) {
+                        break;
+                    }
+                    try {
+                        RunPendingWork();
+                    } catch (std::exception &e) {
+                        FACTORY_LOG_ERROR("[ERROR] Failed to run pending work with error: ", e.what());
+                    }
+                    metrics_.RecordBusy(clock_->Now() - started);
+                    continue;
                 }
+                Command cmd = std::move(*next);
 
-                Command cmd = std::move(workQueue_.front());
-                workQueue_.pop();
-                lock.unlock(); // if this throws the command is lost. But this should never happen as mutex gets locked above.
-
-                std::visit([this](auto&& c) {
+                std::visit([this, started](auto&& c) {
                     using C = std::decay_t<decltype(c)>;
                     StepStatus success;
                     if constexpr (std::is_same_v<C, TransportCommand>) {
-                        std::cout << "[MOVER] " << Name() << " picking up transport command from queue"  << std::endl;
+                        FACTORY_LOG_INFO("[MOVER] ", Name(), " picking up transport command from queue");
                         try {
                             success = OnTransport(c);
                         } catch (std::exception &e) {
-                            std::cerr << "[ERROR] Failed to execute the transport command with error: " << e.what() << std::endl;
+                            FACTORY_LOG_ERROR("[ERROR] Failed to execute the transport command with error: ", e.what());
                             success = ERROR;
                         }
-                        c.cmdCompleted.set_value(success);
+                        FinishCommand(c, started, success);
                     } else if constexpr (std::is_same_v<C, ProcessCommand>) {
-                        std::cout << "[PRODUCER] " << name_ << " picking up process command from queue" << std::endl;
-                        try {
-                            success = OnProcess(c);
-                        } catch (std::exception &e) {
-                            std::cerr << "[ERROR] Failed to execute the process command with error: " << e.what() << std::endl;
-                            success = ERROR;
-                        }
-                        c.cmdCompleted.set_value(success);
+                        RunProcessCommand(c);
                     } else if constexpr (std::is_same_v<C, GenerateResourceCommand>) {
                         try {
-                            OnGenerate(c);
+                            success = OnGenerate(c);
                         } catch (std::exception &e) {
-                            std::cerr << "[ERROR] Failed to execute the generate_material command with error: " << e.what() << std::endl;
+                            FACTORY_LOG_ERROR("[ERROR] Failed to execute the generate_material command with error: ", e.what());
+                            success = ERROR;
                         }
+                        FinishCommand(c, started, success);
                     }
                 }, cmd);
+                metrics_.RecordBusy(clock_->Now() - started);
             }
         }
 
         std::string name_;
+        MachineId id_{UNASSIGNED_MACHINE_ID};
+        Clock* clock_{&DefaultClock()};
         std::thread workerThread_;
-        std::mutex workMutex_;
-        std::condition_variable workCondition_;
-        std::queue<Command> workQueue_;
+        Concurrency::MpscQueue<Command> workQueue_;
         std::atomic_bool shouldStop_{false};
         std::atomic_bool running_{false};
+        std::atomic<size_t> queueDepth_{0};
+        std::atomic<InventoryObserver*> inventoryObserver_{nullptr};
+        Metrics::MachineMetrics metrics_;
+        std::uint64_t traceSequence_{0}; // worker thread only
     };
 }
 
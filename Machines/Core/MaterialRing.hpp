@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace Factory::Machinery {
+
+    // Slots a ring allocates on its first push; it doubles whenever it fills up
+    inline constexpr size_t MATERIAL_RING_INITIAL_CAPACITY = 16;
+
+    /**
+     * FIFO of one item type, typically MaterialHandle, stored by value in a power-of-two ring.
+     * Pushing and popping are an index mask rather than a deque chunk walk.
+     * Not synchronized; guard with the owning machine's lock for that kind.
+     */
+    template<class T>
+    class MaterialRing {
+        static_assert(std::is_nothrow_move_constructible_v<T>, "growing relocates items and must not throw");
+
+    public:
+        MaterialRing() = default;
+
+        MaterialRing(const MaterialRing&) = delete;
+        MaterialRing& operator=(const MaterialRing&) = delete;
+
+        ~MaterialRing() {
+            while (size_ > 0) {
+                Slot(head_)->~T();
+                head_ = (head_ + 1) & (capacity_ - 1);
+                --size_;
+            }
+        }
+
+        /** Appends an item.
+         * @throws std::bad_alloc if the ring has to grow and cannot
+         * Exception guarantee: strong
+         */
+        void Push(T&& item) {
+            if (size_ == capacity_) {
+                Grow();
+            }
+            new (Slot((head_ + size_) & (capacity_ - 1))) T(std::move(item));
+            ++size_;
+        }
+
+        // Removes the oldest item, or returns std::nullopt if the ring is empty
+        std::optional<T> Pop() noexcept {
+            if (size_ == 0) {
+                return std::nullopt;
+            }
+            T* slot = Slot(head_);
+            std::optional<T> item(std::move(*slot));
+            slot->~T();
+            head_ = (head_ + 1) & (capacity_ - 1);
+            --size_;
+            return item;
+        }
+
+        size_t Size() const noexcept { return size_; }
+
+        bool Empty() const noexcept { return size_ == 0; }
+
+    private:
+        struct alignas(T) Storage {
+            std::byte bytes[sizeof(T)];
+        };
+
+        T* Slot(size_t index) noexcept { return std::launder(reinterpret_cast<T*>(&slots_[index])); }
+
+        void Grow() {
+            const size_t capacity = capacity_ == 0 ? MATERIAL_RING_INITIAL_CAPACITY : capacity_ * 2;
+            auto slots = std::make_unique<Storage[]>(capacity);
+            for (size_t i = 0; i < size_; ++i) {
+                T* from = Slot((head_ + i) & (capacity_ - 1));
+                new (&slots[i]) T(std::move(*from));
+                from->~T();
+            }
+            slots_ = std::move(slots);
+            capacity_ = capacity;
+            head_ = 0;
+        }
+
+        std::unique_ptr<Storage[]> slots_;
+        size_t capacity_{0}; // always 0 or a power of two
+        size_t head_{0};
+        size_t size_{0};
+    };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../../Materials/AnyMaterial.hpp"
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+
+namespace Factory::Machinery {
+
+    /**
+     * One-shot subscription for "material of kind K is available".
+     * Whoever claims it first (the machine making material available, or a deadline
+     * timer) gets to act on it; later claims fail.
+     */
+    struct MaterialWait {
+        explicit MaterialWait(std::function<void()> callback) : onAvailable(std::move(callback)) {}
+
+        bool TryClaim() noexcept { return !claimed.exchange(true); }
+
+        std::atomic_bool claimed{false};
+        std::atomic_bool fired{false}; // set when the machine, not a deadline, claimed it
+        std::function<void()> onAvailable;
+    };
+
+    using MaterialWaitPtr = std::shared_ptr<MaterialWait>;
+
+    // Per-kind FIFO of subscriptions; not synchronized, guard each kind with the owning machine's lock for it
+    class MaterialWaiters {
+    public:
+        /** Queues a subscription.
+         * @throws std::bad_alloc
+         * Exception guarantee: strong
+         */
+        void Add(Data::MaterialKind kind, MaterialWaitPtr wait) {
+            waiters_.at(static_cast<size_t>(kind)).push_back(std::move(wait));
+        }
+
+        /** Claims the oldest live subscription for `kind`, skipping ones already claimed
+         * elsewhere (e.g. timed out). One unit of material wakes at most one waiter.
+         * The caller must invoke the returned callback after releasing its lock.
+         */
+        MaterialWaitPtr ClaimOne(Data::MaterialKind kind) noexcept {
+            auto& queue = waiters_[static_cast<size_t>(kind)];
+            while (!queue.empty()) {
+                MaterialWaitPtr wait = std::move(queue.front());
+                queue.pop_front();
+                if (wait->TryClaim()) {
+                    return wait;
+                }
+            }
+            return nullptr;
+        }
+
+        // Invokes a claimed subscription, if any
+        static void Fire(const MaterialWaitPtr& wait) noexcept {
+            if (wait) {
+                wait->fired.store(true);
+            }
+            if (wait && wait->onAvailable) {
+                try {
+                    wait->onAvailable();
+                } catch (...) {
+                    // A failing subscriber must not break the machine that made material available
+                }
+            }
+        }
+
+    private:
+        std::array<std::deque<MaterialWaitPtr>, Data::MATERIAL_KIND_COUNT> waiters_;
+    };
+}
@@ -1,36 +1,318 @@
 #include "Mover.hpp"
+#include <algorithm>
+#include <chrono>
 #include <exception>
-#include <iostream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
 
 #include "../../MachineConepts.hpp"
 
 namespace Factory::Machinery{
-    void Mover::TryReceive(Data::AnyMaterial&&) {
+    void Mover::TryReceive(Data::MaterialHandle&&) {
         throw std::runtime_error("Mover does not accept materials directly");
     }
 
-    StepStatus Mover::OnTransport(const TransportCommand& cmd) {
+    void Mover::SetCapacity(size_t items) {
+        if (items == 0) {
+            throw std::invalid_argument("mover capacity must be positive");
+        }
+        capacity_.store(items);
+    }
+
+    void Mover::SetSpeed(double metersPerSecond) {
+        if (!(metersPerSecond > 0.0)) {
+            throw std::invalid_argument("mover speed must be positive");
+        }
+        speed_.store(metersPerSecond);
+    }
+
+    MachineId Mover::Location() const noexcept {
+        const MachineId location = location_.load();
+        return location == UNASSIGNED_MACHINE_ID ? Id() : location;
+    }
+
+    std::optional<double> Mover::DistanceTo(const MachineBase& machine) const {
+        if (!layout_) {
+            return std::nullopt;
+        }
+        return layout_->Distance(Location(), machine.Id());
+    }
+
+    void Mover::EnqueueTrip(std::vector<TransportCommand> loads) {
+        if (loads.empty()) {
+            return;
+        }
+        for (const auto& cmd : loads) {
+            if (&cmd.source != &loads.front().source) {
+                throw std::invalid_argument("[MOVER] a trip picks up at one source");
+            }
+        }
+        std::list<QueuedTransport> queued;
+        size_t admitted = 0;
+        try {
+            for (auto& cmd : loads) {
+                Admit(cmd);
+                ++admitted;
+                queued.push_back(QueuedTransport{std::move(cmd), 0});
+            }
+        } catch (std::exception& e) {
+            for (; admitted > 0; --admitted) {
+                Retract();
+            }
+            FACTORY_LOG_ERROR("[ERROR] Failed to enqueue trip with error: ", e.what());
+            throw;
+        }
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex_);
+            const std::uint64_t group = nextGroup_++;
+            for (auto& entry : queued) {
+                entry.group = group;
+            }
+            pending_.splice(pending_.end(), queued);
+            pendingCount_.fetch_add(loads.size());
+        }
+        FACTORY_LOG_INFO("[MOVER] ", Name(), " enqueued ", loads.size(), " transport command(s) as one trip");
+        Wake();
+    }
+
+    bool Mover::HasOpenTrip(const MachineBase& source, size_t items) const noexcept {
+        // Packs this source's queued groups into trips the way PopTrip will: a group that does
+        // not fit in the current trip starts the next one, and only a group larger than a
+        // whole trip is split. Whatever the last trip has left over is open.
+        const size_t capacity = capacity_.load();
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        size_t loaded = 0; // in the last trip
+        for (auto it = pending_.begin(); it != pending_.end();) {
+            if (&it->command.source != &source) {
+                ++it;
+                continue;
+            }
+            size_t size = 0;
+            for (auto member = it; member != pending_.end() && member->group == it->group; ++member) {
+                ++size;
+            }
+            std::advance(it, static_cast<std::ptrdiff_t>(size));
+            if (loaded > 0 && size > capacity - loaded) {
+                loaded = 0;
+            }
+            loaded = (loaded + size) % capacity;
+        }
+        return loaded > 0 && items <= capacity - loaded;
+    }
+
+    bool Mover::DivertCommand(Command& cmd) {
+        auto* transport = std::get_if<TransportCommand>(&cmd);
+        if (transport == nullptr) {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex_);
+            pending_.push_back(QueuedTransport{std::move(*transport), nextGroup_});
+            ++nextGroup_;
+            pendingCount_.fetch_add(1);
+        }
+        Wake();
+        return true;
+    }
+
+    void Mover::RunPendingWork() {
+        auto trip = PopTrip(capacity_.load());
+        if (trip.empty()) {
+            return;
+        }
+        FACTORY_LOG_INFO("[MOVER] ", Name(), " picking up ", trip.size(), " transport command(s) for one trip");
+        const auto started = GetClock().Now();
+        std::vector<StepStatus> statuses;
+        try {
+            statuses = RunTrip(trip);
+        } catch (std::exception& e) {
+            FACTORY_LOG_ERROR("[ERROR] Failed to execute the transport command with error: ", e.what());
+            statuses.assign(trip.size(), ERROR);
+        }
+        for (size_t i = 0; i < trip.size(); ++i) {
+            FinishCommand(trip[i], started, statuses[i]);
+        }
+    }
+
+    std::vector<TransportCommand> Mover::PopTrip(size_t capacity) {
+        std::vector<TransportCommand> trip;
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        if (pending_.empty()) {
+            return trip;
+        }
+        trip.reserve(std::min(capacity, pending_.size()));
+        const MachineBase* source = NextSource();
+        for (auto it = pending_.begin(); it != pending_.end() && trip.size() < capacity;) {
+            if (&it->command.source != source) {
+                ++it;
+                continue;
+            }
+            // Commands enqueued together ride together; only a group larger than a whole trip is split.
+            // Counting stops once the group is known not to fit.
+            const size_t room = capacity - trip.size();
+            size_t size = 0;
+            for (auto member = it; member != pending_.end() && member->group == it->group && size <= room; ++member) {
+                ++size;
+            }
+            if (!trip.empty() && size > room) {
+                break;
+            }
+            for (size_t i = 0; i < size && trip.size() < capacity; ++i) {
+                trip.push_back(std::move(it->command));
+                it = pending_.erase(it);
+                pendingCount_.fetch_sub(1);
+            }
+        }
+        return trip;
+    }
+
+    const MachineBase* Mover::NextSource() {
+        const MachineBase* oldest = &pending_.front().command.source;
+        if (!layout_ || chainedInRow_ >= MAX_CHAINED_TRIPS) {
+            chainedInRow_ = 0;
+            return oldest;
+        }
+        const MachineId here = Location();
+        const MachineBase* closest = oldest;
+        double closestDistance = layout_->Distance(here, oldest->Id()).value_or(std::numeric_limits<double>::infinity());
+        size_t looked = 0;
+        for (auto it = pending_.begin(); it != pending_.end() && looked < CHAIN_LOOKAHEAD && closestDistance > 0.0;
+             ++it, ++looked) {
+            const auto distance = layout_->Distance(here, it->command.source.Id());
+            if (distance && *distance < closestDistance) {
+                closest = &it->command.source;
+                closestDistance = *distance;
+            }
+        }
+        chainedInRow_ = closest == oldest ? 0 : chainedInRow_ + 1;
+        return closest;
+    }
+
+    Clock::Duration Mover::Travel(MachineId from, MachineId to, Clock::Duration fallback) const {
+        const auto meters = layout_ ? layout_->Distance(from, to) : std::nullopt;
+        if (!meters) {
+            return fallback;
+        }
+        return std::chrono::duration_cast<Clock::Duration>(std::chrono::duration<double>(*meters / speed_.load()));
+    }
+
+    void Mover::Drive(Clock::Duration duration, std::atomic<Clock::Duration::rep>& total) {
+        if (duration <= Clock::Duration::zero()) {
+            return;
+        }
+        GetClock().SleepFor(duration);
+        total.fetch_add(duration.count());
+    }
+
+    std::vector<StepStatus> Mover::RunTrip(std::vector<TransportCommand>& trip) {
+        std::vector<StepStatus> statuses(trip.size(), ERROR);
+        std::vector<Data::MaterialHandle> materials(trip.size());
+        std::vector<MachineBase*> stops;
+        stops.reserve(trip.size());
+        size_t loaded = 0;
+
+        // Empty run to the source; without a layout the mover is simply there
+        MachineBase& source = trip.front().source;
+        const MachineId start = Location();
+        const bool chained = trips_.load() > 0 && start == source.Id();
+        location_.store(source.Id());
+        Drive(Travel(start, source.Id(), Clock::Duration::zero()), emptyTravel_);
+        for (size_t i = 0; i < trip.size(); ++i) {
+            try {
+                statuses[i] = Load(trip[i], materials[i]);
+            } catch (std::exception& e) {
+                FACTORY_LOG_ERROR("[MOVER] ", Name(), " failed to load material_kind=",
+                                  Data::toString(trip[i].material_kind), " with error: ", e.what());
+                statuses[i] = ERROR;
+            }
+            if (!materials[i]) {
+                continue;
+            }
+            ++loaded;
+            if (std::find(stops.begin(), stops.end(), &trip[i].destination) == stops.end()) {
+                stops.push_back(&trip[i].destination);
+            }
+        }
+        if (loaded == 0) {
+            return statuses;
+        }
+
+        // Loaded runs, always on to the nearest remaining stop, dropping materials off on arrival
+        MachineId at = source.Id();
+        Clock::Duration fallback = std::chrono::milliseconds(TRANSPORT_TIME_MS);
+        while (!stops.empty()) {
+            auto next = stops.begin();
+            double nearest = std::numeric_limits<double>::infinity();
+            for (auto it = stops.begin(); layout_ && it != stops.end(); ++it) {
+                const auto distance = layout_->Distance(at, (*it)->Id());
+                if (distance && *distance < nearest) {
+                    next = it;
+                    nearest = *distance;
+                }
+            }
+            MachineBase& stop = **next;
+            stops.erase(next);
+            location_.store(stop.Id());
+            Drive(Travel(at, stop.Id(), fallback), loadedTravel_);
+            fallback = std::chrono::milliseconds(TRANSPORT_STOP_MS);
+            at = stop.Id();
+            for (size_t i = 0; i < trip.size(); ++i) {
+                if (materials[i] && &trip[i].destination == &stop) {
+                    statuses[i] = Unload(trip[i], std::move(materials[i]));
+                }
+            }
+        }
+        trips_.fetch_add(1);
+        loads_.fetch_add(loaded);
+        if (chained) {
+            chained_.fetch_add(1);
+        }
+        return statuses;
+    }
+
+    StepStatus Mover::Load(const TransportCommand& cmd, Data::MaterialHandle& material) {
+        if (!cmd.destination.CanAccept(cmd.material_kind)) {
+            FACTORY_LOG_ERROR("[MOVER] ", Name(), " the destination: ", cmd.destination.Name(),
+                              " does not accept material_kind=", Data::toString(cmd.material_kind));
+            return ERROR;
+        }
+
+        // Backpressure: only pick up material the destination has room for
+        if (!cmd.destination.ReserveSpace(cmd.material_kind)) {
+            FACTORY_LOG_INFO("[MOVER] ", Name(), " destination ", cmd.destination.Name(),
+                             " is full for kind: ", Data::toString(cmd.material_kind));
+            return BLOCKED;
+        }
+
         // Take material from the source
-        auto material = cmd.source.TakeMaterial(cmd.material_kind);
-        if (!material.has_value()) {
-            std::cout << "[MOVER] " << Name() << " source " << cmd.source.Name() 
-                      << " has no materials of kind: " << Data::toString(cmd.material_kind) << std::endl;
+        try {
+            material = cmd.source.TakeMaterial(cmd.material_kind);
+        } catch (...) {
+            cmd.destination.ReleaseReservation(cmd.material_kind);
+            throw;
+        }
+        if (!material) {
+            cmd.destination.ReleaseReservation(cmd.material_kind);
+            FACTORY_LOG_INFO("[MOVER] ", Name(), " source ", cmd.source.Name(),
+                             " has no materials of kind: ", Data::toString(cmd.material_kind));
             return RETRY;
         }
-        
-        // Simulates time to move
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        return SUCCESS;
+    }
 
+    StepStatus Mover::Unload(const TransportCommand& cmd, Data::MaterialHandle&& material) {
         try {
-            cmd.destination.TryReceive(std::move(*material));
+            cmd.destination.TryReceive(std::move(material));
         } catch (std::exception& e) {
-            std::cerr << "[MOVER] " << Name() << " the destination: " << cmd.destination.Name()
-                      << " failed to receive material_kind=" << Data::toString(cmd.material_kind)
-                      << " with error: " << e.what() << std::endl;
-            throw;
+            cmd.destination.ReleaseReservation(cmd.material_kind);
+            FACTORY_LOG_ERROR("[MOVER] ", Name(), " the destination: ", cmd.destination.Name(),
+                              " failed to receive material_kind=", Data::toString(cmd.material_kind),
+                              " with error: ", e.what());
+            return ERROR;
         }
-        std::cout << "[MOVER] " << Name() << " moved material_kind=" << Data::toString(cmd.material_kind) 
-                  << " from " << cmd.source.Name() << " to " << cmd.destination.Name() << std::endl;
+        FACTORY_LOG_INFO("[MOVER] ", Name(), " moved material_kind=", Data::toString(cmd.material_kind),
+                         " from ", cmd.source.Name(), " to ", cmd.destination.Name());
         return SUCCESS;
     }
 
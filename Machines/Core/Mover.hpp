@@ -1,8 +1,52 @@
 #pragma once
 #include "MachineBase.hpp"
+#include "FactoryLayout.hpp"
 #include "../../Shared.hpp"
 
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
 namespace Factory::Machinery {
+    // Simulated time of a loaded run from the source to the first destination when the
+    // layout does not know the distance (milliseconds)
+    inline constexpr int TRANSPORT_TIME_MS = 1000;
+    // Simulated time between two drop-offs of one trip when the layout does not know the distance (milliseconds)
+    inline constexpr int TRANSPORT_STOP_MS = 250;
+
+    // Materials a mover carries per trip unless configured otherwise
+    inline constexpr size_t DEFAULT_MOVER_CAPACITY = 1;
+    // Travel speed of a mover unless configured otherwise (meters per second)
+    inline constexpr double DEFAULT_MOVER_SPEED_MPS = 2.0;
+    // Trips in a row a mover may start closer by, ahead of the oldest queued command
+    inline constexpr int MAX_CHAINED_TRIPS = 3;
+    // Queued commands looked at when picking the closest next trip
+    inline constexpr size_t CHAIN_LOOKAHEAD = 16;
+
+    struct TripStats {
+        std::uint64_t trips;          // trips that carried at least one material
+        std::uint64_t loads;          // materials carried over all those trips
+        std::uint64_t chained;        // trips that started where the previous one ended
+        Clock::Duration emptyTravel;  // runs to a trip's source
+        Clock::Duration loadedTravel; // runs from the source through the drop-offs
+    };
+
+    /**
+     * Carries materials between machines. Transport commands are queued per mover; each trip
+     * takes the oldest one plus further queued commands from the same source, up to the
+     * mover's capacity, picks all their materials up at once and drops them off at their
+     * destinations, possibly several, before the next trip starts.
+     *
+     * With a FactoryLayout, travel takes distance / speed: an empty run from wherever the
+     * mover stands to the source, then a loaded run to each destination, nearest first.
+     * To cut empty runs, a mover prefers queued trips that start where it is, e.g. taking
+     * finished parts out of the machine it just delivered to, for at most MAX_CHAINED_TRIPS
+     * trips ahead of older commands. Without distances it falls back to the fixed times above.
+     */
     class Mover : public MachineBase {
     public:
         using MachineBase::MachineBase;
@@ -15,10 +59,103 @@ namespace Factory::Machinery {
          * guarantee: strong
          * no changes to machine state on throws
          */
-        void TryReceive(Data::AnyMaterial&& material) override;
+        void TryReceive(Data::MaterialHandle&& material) override;
         bool CanAccept(Data::MaterialKind) const noexcept override { return false; }
 
+        /** Sets how many materials one trip may carry.
+         * @throws std::invalid_argument if items is 0
+         */
+        void SetCapacity(size_t items);
+
+        size_t Capacity() const noexcept { return capacity_.load(); }
+
+        /** Sets the floor plan travel times are derived from.
+         * Must be called before StartThread().
+         */
+        void SetLayout(std::shared_ptr<const FactoryLayout> layout) noexcept { layout_ = std::move(layout); }
+
+        /** Sets the travel speed in meters per second.
+         * @throws std::invalid_argument unless metersPerSecond is positive
+         */
+        void SetSpeed(double metersPerSecond);
+
+        double Speed() const noexcept { return speed_.load(); }
+
+        // Machine the mover stands at, or is travelling to on its current trip; its own id
+        // (its home position) before its first trip
+        MachineId Location() const noexcept;
+
+        // Length of an empty run from Location() to `machine`; std::nullopt if the layout does not know it
+        std::optional<double> DistanceTo(const MachineBase& machine) const;
+
+        /** Enqueues transport commands from one source that should share a trip, e.g. the
+         * moves of one job. They ride together unless there are more than Capacity(); a trip
+         * that cannot fit all of them leaves them for the next one.
+         * @throws std::invalid_argument if the commands have different sources
+         * @throws std::bad_alloc
+         * Exception guarantee: strong
+         * No commands are queued on throws.
+         */
+        void EnqueueTrip(std::vector<TransportCommand> loads);
+
+        // True if `items` more materials from `source`, enqueued together, would ride on the
+        // last trip already queued from it rather than start a new one
+        bool HasOpenTrip(const MachineBase& source, size_t items = 1) const noexcept;
+
+        TripStats GetTripStats() const noexcept {
+            return TripStats{trips_.load(), loads_.load(), chained_.load(), Clock::Duration(emptyTravel_.load()),
+                             Clock::Duration(loadedTravel_.load())};
+        }
+
     protected:
-        StepStatus OnTransport(const TransportCommand& cmd) override;
+        bool DivertCommand(Command& cmd) override;
+
+        bool HasPendingWork() const noexcept override { return pendingCount_.load() > 0; }
+
+        void RunPendingWork() override;
+
+    private:
+        // Pops up to `capacity` queued commands from one source: the oldest command's, or
+        // a closer one while chaining is allowed
+        std::vector<TransportCommand> PopTrip(size_t capacity);
+
+        // Source the next trip should start from; caller holds pendingMutex_
+        const MachineBase* NextSource();
+
+        // Time to travel between two machines, or `fallback` if the layout does not know the distance
+        Clock::Duration Travel(MachineId from, MachineId to, Clock::Duration fallback) const;
+
+        // Sleeps through one run and books it
+        void Drive(Clock::Duration duration, std::atomic<Clock::Duration::rep>& total);
+
+        // Runs one trip; returns the status of each of its commands
+        std::vector<StepStatus> RunTrip(std::vector<TransportCommand>& trip);
+
+        // Reserves room at the destination and takes the material from the source
+        StepStatus Load(const TransportCommand& cmd, Data::MaterialHandle& material);
+
+        StepStatus Unload(const TransportCommand& cmd, Data::MaterialHandle&& material);
+
+        // A queued command and the EnqueueTrip call (or single enqueue) it came with
+        struct QueuedTransport {
+            TransportCommand command;
+            std::uint64_t group;
+        };
+
+        std::list<QueuedTransport> pending_; // commands hold references, so they are spliced rather than moved
+        mutable std::mutex pendingMutex_;
+        std::uint64_t nextGroup_{0}; // guarded by pendingMutex_
+        std::atomic<size_t> pendingCount_{0};
+        std::atomic<size_t> capacity_{DEFAULT_MOVER_CAPACITY};
+        std::shared_ptr<const FactoryLayout> layout_;
+        std::atomic<double> speed_{DEFAULT_MOVER_SPEED_MPS};
+        std::atomic<MachineId> location_{UNASSIGNED_MACHINE_ID};
+        int chainedInRow_{0}; // guarded by pendingMutex_
+
+        std::atomic<std::uint64_t> trips_{0};
+        std::atomic<std::uint64_t> loads_{0};
+        std::atomic<std::uint64_t> chained_{0};
+        std::atomic<Clock::Duration::rep> emptyTravel_{0};
+        std::atomic<Clock::Duration::rep> loadedTravel_{0};
     };
 }
@@ -1,13 +1,21 @@
 #pragma once
 
 #include "MachineBase.hpp"
+#include "MaterialRing.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <concepts>
-#include <iostream>
+#include <deque>
+#include <limits>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <optional>
+#include <stdexcept>
 #include <type_traits>
 #include <string>
+#include <vector>
 
 namespace Factory::Machinery {
     template<class T>
@@ -15,70 +23,647 @@ namespace Factory::Machinery {
         { T::kind } -> std::convertible_to<Data::MaterialKind>;
     };
 
+    template<HasMaterialKind T>
+    class ProducerGroup;
+
+    // Simulated time of one processing cycle: a fixed setup plus a cost per item in the batch
+    struct ProcessCost {
+        Clock::Duration setup{};
+        Clock::Duration perItem{};
+    };
+
     template<HasMaterialKind T>
     class Producer : public MachineBase {
     public:
         using MachineBase::MachineBase;
+        using InputType = T;
+
+        /** Makes this machine a member of a pool of interchangeable producers.
+         * Process commands sent to it may then be executed by any idle member.
+         * Must be called before StartThread().
+         */
+        void JoinGroup(std::shared_ptr<ProducerGroup<T>> group) noexcept {
+            group_ = std::move(group);
+            group_->Add(*this);
+        }
 
         // Receiver API (via MachineBase)
         bool CanAccept(Data::MaterialKind kind) const noexcept override {
             return kind == T::kind;
         }
 
-        void TryReceive(Data::AnyMaterial&& material) override {
-            if (!CanAccept(Data::kind_of(material))) {
+        void SetCostModel(const ProcessCost& cost) noexcept {
+            setupCost_.store(cost.setup.count());
+            perItemCost_.store(cost.perItem.count());
+        }
+
+        ProcessCost GetCostModel() const noexcept {
+            return ProcessCost{Clock::Duration(setupCost_.load()), Clock::Duration(perItemCost_.load())};
+        }
+
+        /** Sets how many items one cycle may process when queued commands are coalesced.
+         * A single batch command may still ask for more.
+         * @throws std::invalid_argument if maxItems is 0
+         */
+        void SetMaxBatchSize(size_t maxItems) {
+            if (maxItems == 0) {
+                throw std::invalid_argument("batch size must be positive");
+            }
+            maxBatchSize_.store(maxItems);
+        }
+
+        /** Queues a process command for this producer without going through the Command variant.
+         * For callers that know the producer's type; behaves like EnqueueCommand otherwise.
+         * @throws std::bad_alloc
+         * Exception guarantee: strong
+         * No changes to the queue on throws.
+         */
+        void EnqueueProcess(ProcessCommand cmd) {
+            Admit(cmd);
+            try {
+                QueuePending(std::move(cmd));
+            } catch (...) {
+                Retract();
+                throw;
+            }
+            FACTORY_LOG_INFO("[PRODUCER] ", Name(), " enqueued process command");
+        }
+
+        void TryReceive(Data::MaterialHandle&& material) override {
+            if (!CanAccept(material.Kind())) {
                 throw std::invalid_argument("Producer received material of non-compatible type");
             }
+            MaterialWaitPtr woken;
+            {
+                std::lock_guard<std::mutex> lock(inventory_mutex_);
+                inventory_.Push(std::move(material));
+                inputBudget_.Add();
+                woken = waiters_.ClaimOne(T::kind);
+            }
+            ReportStock(T::kind, +1);
+            if (!woken && group_) {
+                woken = group_->ClaimWaiter(T::kind, *this);
+            }
+            MaterialWaiters::Fire(woken);
+        }
+
+        bool ReserveSpace(Data::MaterialKind kind) override {
+            std::lock_guard<std::mutex> lock(inventory_mutex_);
+            return kind == T::kind && inputBudget_.TryReserve();
+        }
+
+        void ReleaseReservation(Data::MaterialKind kind) noexcept override {
+            MaterialWaitPtr woken;
+            {
+                std::lock_guard<std::mutex> lock(inventory_mutex_);
+                if (kind != T::kind) {
+                    return;
+                }
+                inputBudget_.ReleaseReservation();
+                woken = ClaimSpaceWaiter(T::kind);
+            }
+            MaterialWaiters::Fire(woken);
+        }
+
+        /** Sets the limit for the input kind T or for one output kind (thread-safe).
+         * Outputs are only drained by transports, so a full output kind blocks processing.
+         * @throws std::invalid_argument on an invalid kind or inconsistent limit
+         */
+        void SetLimit(Data::MaterialKind kind, const InventoryLimit& limit) {
             std::lock_guard<std::mutex> lock(inventory_mutex_);
-            inventory_.push(std::get<T>(std::move(material)));
+            BudgetFor(kind).SetLimit(limit);
         }
 
-        std::optional<Data::AnyMaterial> TakeMaterial(Data::MaterialKind kind) override {
-            if (outputs_.empty()) {
-                return std::nullopt;
+        std::vector<Occupancy> GetOccupancy() const override {
+            std::lock_guard<std::mutex> lock(inventory_mutex_);
+            std::vector<Occupancy> result{inputBudget_.Snapshot(T::kind)};
+            for (size_t i = 0; i < outputBudgets_.size(); ++i) {
+                auto snapshot = outputBudgets_[i].Snapshot(static_cast<Data::MaterialKind>(i));
+                if (snapshot.stored > 0 || snapshot.capacity != UNBOUNDED) {
+                    result.push_back(snapshot);
+                }
             }
-            if (Data::kind_of(outputs_.front()) != kind) {
-                return std::nullopt;
+            return result;
+        }
+
+        /** Puts input items (kind T) or finished outputs of any other kind back, past their limits if need be.
+         * @throws std::invalid_argument for an invalid kind
+         * @throws std::bad_alloc
+         * Exception guarantee: basic
+         */
+        void Restock(Data::MaterialKind kind, size_t count) override {
+            if (kind >= Data::MaterialKind::Invalid) {
+                throw std::invalid_argument("[PRODUCER] cannot restock an invalid material kind");
+            }
+            MaterialWaitPtr woken;
+            {
+                std::lock_guard<std::mutex> lock(inventory_mutex_);
+                auto& budget = BudgetFor(kind);
+                for (size_t i = 0; i < count; ++i) {
+                    auto material = Data::MaterialArena::Instance().Create(Data::makeMaterial(kind));
+                    if (kind == T::kind) {
+                        inventory_.Push(std::move(material));
+                    } else {
+                        outputs_.push_back(std::move(material));
+                    }
+                    budget.Add();
+                }
+                woken = waiters_.ClaimOne(kind);
+            }
+            MaterialWaiters::Fire(woken);
+            FACTORY_LOG_INFO("[PRODUCER] ", Name(), " restocked ", count, " ", Data::toString(kind));
+        }
+
+        // Input kind T: fires once a reservation can succeed. Other kinds: fires when outputs have room.
+        bool NotifyWhenSpace(Data::MaterialKind kind, const MaterialWaitPtr& wait) override {
+            {
+                std::lock_guard<std::mutex> lock(inventory_mutex_);
+                if (!HasSpaceFor(kind)) {
+                    spaceWaiters_.Add(kind, wait);
+                    return true;
+                }
+            }
+            if (wait->TryClaim()) {
+                MaterialWaiters::Fire(wait);
+            }
+            return true;
+        }
+
+        // Takes the oldest finished output of the given kind, from a group sibling if need be (thread-safe)
+        Data::MaterialHandle TakeMaterial(Data::MaterialKind kind) override {
+            auto material = TakeOwnOutput(kind);
+            if (!material && group_) {
+                material = group_->TakeOutput(kind, *this);
             }
-            auto material = std::move(outputs_.front());
-            outputs_.pop();
             return material;
         }
 
+        // Input kind T: fires once there is something to process. Other kinds: fires on a matching output.
+        // In a group, material at any member counts.
+        bool NotifyWhenAvailable(Data::MaterialKind kind, const MaterialWaitPtr& wait) override {
+            bool available;
+            {
+                std::lock_guard<std::mutex> lock(inventory_mutex_);
+                available = HasAvailableLocked(kind);
+                if (!available) {
+                    waiters_.Add(kind, wait);
+                }
+            }
+            // Subscribed before looking at siblings, so material arriving there meanwhile still finds it
+            if (!available && group_) {
+                available = group_->Available(kind, *this);
+            }
+            if (available && wait->TryClaim()) {
+                MaterialWaiters::Fire(wait);
+            }
+            return true;
+        }
+
     protected:
         StepStatus OnProcess(const ProcessCommand& cmd) override {
             if (cmd.material_kind != T::kind) {
                 throw std::invalid_argument(std::format("[PRODUCER] {} material material_kind mismatch for processing: got={} expected: {}\n",
                     Name(), Data::toString(cmd.material_kind), Data::toString(T::kind)));
             }
-            std::unique_lock<std::mutex> lock(inventory_mutex_);
-            if (inventory_.empty()) {
-                std::cout << "[PRODUCER] " << Name() << " has no material of material_kind " << Data::toString(T::kind) << ". Retrying!" << std::endl;
-                return RETRY;
+            return ProcessBatch(std::vector<ProcessCommand>{cmd}).front();
+        }
+
+        /** Runs one processing cycle for a batch of commands: one setup, then every item.
+         * Items are handed out to the commands in order, up to each command's maxItems.
+         * The cycle takes no more items than its outputs have room for. A command that
+         * received no item reports BLOCKED if that room ran out, else RETRY.
+         * @return one status per command
+         * @throws std::bad_alloc
+         */
+        std::vector<StepStatus> ProcessBatch(const std::vector<ProcessCommand>& batch) {
+            std::vector<StepStatus> statuses(batch.size(), RETRY);
+            size_t wanted = 0;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (batch[i].material_kind != T::kind) {
+                    FACTORY_LOG_ERROR("[PRODUCER] ", Name(), " material_kind mismatch for processing: got=",
+                                      Data::toString(batch[i].material_kind), " expected: ", Data::toString(T::kind));
+                    statuses[i] = ERROR;
+                    continue;
+                }
+                wanted += std::max<size_t>(batch[i].maxItems, 1);
+            }
+            if (wanted == 0) {
+                return statuses;
             }
-            T item = std::move(inventory_.front());
-            inventory_.pop();
-            lock.unlock();
-            try {
-                ProcessOne(std::move(item));
-            } catch (std::exception& e) {
-                std::cerr << "[PRODUCER] " << Name() << " failed to process material of material_kind " << Data::toString(T::kind) << " with error: " << e.what() << std::endl;
-                return ERROR;
+            size_t room;
+            {
+                std::lock_guard<std::mutex> lock(inventory_mutex_);
+                room = OutputRoom();
+            }
+            if (room == 0) {
+                FACTORY_LOG_INFO("[PRODUCER] ", Name(), " has no room for its output. Blocked!");
+                std::replace(statuses.begin(), statuses.end(), RETRY, BLOCKED);
+                return statuses;
+            }
+            // Only this machine's worker emits its outputs, so the room cannot shrink during the cycle
+            const bool roomBound = room < wanted;
+            wanted = std::min(wanted, room);
+
+            // The input may have been delivered to the sibling a command was stolen from
+            std::vector<Data::MaterialHandle> items;
+            items.reserve(wanted);
+            while (items.size() < wanted) {
+                auto item = TakeInput();
+                if (!item && group_) {
+                    item = group_->StealInput(*this);
+                }
+                if (!item) {
+                    break;
+                }
+                items.push_back(std::move(item));
+            }
+            if (items.empty()) {
+                FACTORY_LOG_INFO("[PRODUCER] ", Name(), " has no material of material_kind ", Data::toString(T::kind), ". Retrying!");
+                return statuses;
+            }
+
+            const auto cost = GetCostModel();
+            GetClock().SleepFor(cost.setup);
+            size_t next = 0;
+            for (size_t i = 0; i < batch.size() && next < items.size(); ++i) {
+                if (statuses[i] == ERROR) {
+                    continue;
+                }
+                const size_t share = std::min(std::max<size_t>(batch[i].maxItems, 1), items.size() - next);
+                statuses[i] = SUCCESS;
+                for (size_t k = 0; k < share; ++k) {
+                    GetClock().SleepFor(cost.perItem);
+                    // The payload is used in place; the input is destroyed with its handle
+                    auto input = std::move(items[next++]);
+                    processing_ = input.Id();
+                    try {
+                        ProcessOne(std::move(Data::MaterialArena::Instance().Get<T>(input)));
+                    } catch (std::exception& e) {
+                        FACTORY_LOG_ERROR("[PRODUCER] ", Name(), " failed to process material of material_kind ",
+                                          Data::toString(T::kind), " with error: ", e.what());
+                        statuses[i] = ERROR;
+                    }
+                }
             }
-            return SUCCESS;
+            if (roomBound && items.size() == wanted) {
+                std::replace(statuses.begin(), statuses.end(), RETRY, BLOCKED);
+            }
+            if (items.size() > 1) {
+                FACTORY_LOG_INFO("[PRODUCER] ", Name(), " processed a batch of ", items.size(), " items");
+            }
+            return statuses;
         }
 
         // Optional helper for derived producers: store output material for later pickup.
-        void Emit(Data::AnyMaterial&& out) {
-            outputs_.push(std::move(out));
+        // Called from ProcessOne, the output records the item being processed as its parent.
+        template<class U>
+        void Emit(U&& out) {
+            auto material = Data::MaterialArena::Instance().Create(std::forward<U>(out), processing_);
+            const auto kind = material.Kind();
+            FACTORY_LOG_DEBUG("[PRODUCER] ", Name(), " emitted ", Data::toString(kind), " #",
+                              material.Id().Value(), " from #", processing_.Value());
+            MaterialWaitPtr woken;
+            {
+                std::lock_guard<std::mutex> lock(inventory_mutex_);
+                outputs_.push_back(std::move(material));
+                BudgetFor(kind).Add();
+                woken = waiters_.ClaimOne(kind);
+            }
+            ReportStock(kind, +1);
+            if (!woken && group_) {
+                woken = group_->ClaimWaiter(kind, *this);
+            }
+            MaterialWaiters::Fire(woken);
         }
 
         virtual void ProcessOne(T&& item) = 0;
 
+        // Process commands are queued per machine, where they can be coalesced into batches
+        // and, in a group, stolen by idle siblings
+        bool DivertCommand(Command& cmd) override {
+            auto* process = std::get_if<ProcessCommand>(&cmd);
+            if (process == nullptr) {
+                return false;
+            }
+            QueuePending(std::move(*process));
+            return true;
+        }
+
+        bool HasPendingWork() const noexcept override {
+            return pendingCount_.load() > 0 || (group_ && group_->Queued() > 0);
+        }
+
+        void RunPendingWork() override {
+            const size_t maxItems = maxBatchSize_.load();
+            auto batch = PopPending(maxItems);
+            if (batch.empty() && group_) {
+                batch = group_->Steal(*this, maxItems);
+            }
+            if (batch.empty()) {
+                return;
+            }
+            FACTORY_LOG_INFO("[PRODUCER] ", Name(), " picking up ", batch.size(), " process command(s) from queue");
+            busy_.store(true);
+            const auto started = GetClock().Now();
+            std::vector<StepStatus> statuses;
+            try {
+                statuses = ProcessBatch(batch);
+            } catch (std::exception& e) {
+                FACTORY_LOG_ERROR("[ERROR] Failed to execute the process command with error: ", e.what());
+                statuses.assign(batch.size(), ERROR);
+            }
+            busy_.store(false);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                FinishCommand(batch[i], started, statuses[i]);
+            }
+        }
+
     private:
-        std::queue<T> inventory_;
+        friend class ProducerGroup<T>;
+
+        /** Appends an admitted command to the pending queue and wakes this machine or an idle sibling.
+         * @throws std::bad_alloc
+         * Exception guarantee: strong
+         */
+        void QueuePending(ProcessCommand&& cmd) {
+            {
+                std::lock_guard<std::mutex> lock(pendingMutex_);
+                pending_.push_back(std::move(cmd));
+                pendingCount_.fetch_add(1);
+            }
+            if (group_) {
+                group_->OnQueued(*this);
+            } else {
+                Wake();
+            }
+        }
+
+        // Pops the oldest queued commands, coalescing them while they fit in `maxItems` items,
+        // up to `maxCommands` commands. The first command is always taken, however many items it asks for.
+        std::vector<ProcessCommand> PopPending(size_t maxItems,
+                                               size_t maxCommands = std::numeric_limits<size_t>::max()) {
+            std::vector<ProcessCommand> batch;
+            std::lock_guard<std::mutex> lock(pendingMutex_);
+            size_t items = 0;
+            while (!pending_.empty() && batch.size() < maxCommands) {
+                const size_t n = std::max<size_t>(pending_.front().maxItems, 1);
+                if (!batch.empty() && items + n > maxItems) {
+                    break;
+                }
+                items += n;
+                batch.push_back(std::move(pending_.front()));
+                pending_.pop_front();
+                pendingCount_.fetch_sub(1);
+                if (group_) {
+                    group_->OnDequeued();
+                }
+            }
+            return batch;
+        }
+
+        Data::MaterialHandle TakeInput() {
+            MaterialWaitPtr woken;
+            Data::MaterialHandle item;
+            {
+                std::lock_guard<std::mutex> lock(inventory_mutex_);
+                auto next = inventory_.Pop();
+                if (!next) {
+                    return {};
+                }
+                item = std::move(*next);
+                inputBudget_.Remove();
+                woken = ClaimSpaceWaiter(T::kind);
+            }
+            ReportStock(T::kind, -1);
+            MaterialWaiters::Fire(woken);
+            return item;
+        }
+
+        Data::MaterialHandle TakeOwnOutput(Data::MaterialKind kind) {
+            MaterialWaitPtr woken;
+            Data::MaterialHandle material;
+            {
+                std::lock_guard<std::mutex> lock(inventory_mutex_);
+                auto it = FindOutput(kind);
+                if (it == outputs_.end()) {
+                    return {};
+                }
+                material = std::move(*it);
+                outputs_.erase(it);
+                BudgetFor(kind).Remove();
+                woken = ClaimSpaceWaiter(kind);
+            }
+            ReportStock(kind, -1);
+            MaterialWaiters::Fire(woken);
+            return material;
+        }
+
+        bool HasAvailable(Data::MaterialKind kind) {
+            std::lock_guard<std::mutex> lock(inventory_mutex_);
+            return HasAvailableLocked(kind);
+        }
+
+        MaterialWaitPtr ClaimOwnWaiter(Data::MaterialKind kind) noexcept {
+            std::lock_guard<std::mutex> lock(inventory_mutex_);
+            return waiters_.ClaimOne(kind);
+        }
+
+        // Caller holds inventory_mutex_ for all helpers below
+        InventoryBudget& BudgetFor(Data::MaterialKind kind) {
+            return kind == T::kind ? inputBudget_ : outputBudgets_.at(static_cast<size_t>(kind));
+        }
+
+        bool HasSpaceFor(Data::MaterialKind kind) const noexcept {
+            return kind == T::kind ? inputBudget_.HasSpace() : !OutputBlocked();
+        }
+
+        // Output kinds are not known before ProcessOne runs, so any full output blocks processing
+        bool OutputBlocked() const noexcept {
+            return std::any_of(outputBudgets_.begin(), outputBudgets_.end(),
+                               [](const InventoryBudget& b) { return b.Full(); });
+        }
+
+        // Items one cycle may process: each emits at most one output of a kind, and any of them
+        // may land in the fullest output kind
+        size_t OutputRoom() const noexcept {
+            size_t room = UNBOUNDED;
+            for (const auto& budget : outputBudgets_) {
+                room = std::min(room, budget.Room());
+            }
+            return room;
+        }
+
+        // Output-side waiters wait for processing to unblock, whichever output kind they named
+        MaterialWaitPtr ClaimSpaceWaiter(Data::MaterialKind kind) noexcept {
+            if (!HasSpaceFor(kind)) {
+                return nullptr;
+            }
+            if (kind == T::kind) {
+                return spaceWaiters_.ClaimOne(kind);
+            }
+            for (size_t i = 0; i < Data::MATERIAL_KIND_COUNT; ++i) {
+                const auto candidate = static_cast<Data::MaterialKind>(i);
+                if (candidate == T::kind) {
+                    continue;
+                }
+                if (auto wait = spaceWaiters_.ClaimOne(candidate)) {
+                    return wait;
+                }
+            }
+            return nullptr;
+        }
+
+        bool HasAvailableLocked(Data::MaterialKind kind) {
+            return kind == T::kind ? !inventory_.Empty() : FindOutput(kind) != outputs_.end();
+        }
+
+        // Kinds are read from the handles; payloads are not touched
+        typename std::deque<Data::MaterialHandle>::iterator FindOutput(Data::MaterialKind kind) {
+            return std::find_if(outputs_.begin(), outputs_.end(), [kind](const Data::MaterialHandle& m) {
+                return m.Kind() == kind;
+            });
+        }
+
+        MaterialRing<Data::MaterialHandle> inventory_;
         mutable std::mutex inventory_mutex_;
-        std::queue<Data::AnyMaterial> outputs_;
+        std::deque<Data::MaterialHandle> outputs_;
+        Data::MaterialId processing_; // input ProcessOne is working on; machine thread only
+        MaterialWaiters waiters_;
+        InventoryBudget inputBudget_;
+        std::array<InventoryBudget, Data::MATERIAL_KIND_COUNT> outputBudgets_;
+        MaterialWaiters spaceWaiters_;
+
+        std::shared_ptr<ProducerGroup<T>> group_;
+        std::deque<ProcessCommand> pending_;
+        std::mutex pendingMutex_;
+        std::atomic<size_t> pendingCount_{0};
+        std::atomic_bool busy_{false};
+
+        std::atomic<Clock::Duration::rep> setupCost_{0};
+        std::atomic<Clock::Duration::rep> perItemCost_{0};
+        std::atomic<size_t> maxBatchSize_{1};
+    };
+
+    // Maximum number of machines in one producer group; covers every machine a Controller can hold
+    inline constexpr size_t MAX_GROUP_SIZE = 1024;
+
+    /**
+     * Pool of interchangeable producers of one machine type.
+     * Each member queues the process commands sent to it; an idle member steals the oldest
+     * command of the sibling with the longest queue. The input for that command may have been
+     * delivered to the victim, so a member short of input takes it from a sibling, and finished
+     * outputs can be picked up through any member. At most one member's lock is held at a time.
+     */
+    template<HasMaterialKind T>
+    class ProducerGroup {
+    public:
+        // Called once per member, before its worker thread starts
+        void Add(Producer<T>& member) noexcept {
+            std::lock_guard<std::mutex> lock(addMutex_);
+            const size_t index = size_.load(std::memory_order_relaxed);
+            members_[index] = &member;
+            size_.store(index + 1, std::memory_order_release);
+        }
+
+        // Process commands queued at all members
+        size_t Queued() const noexcept { return queued_.load(); }
+
+        void OnQueued(Producer<T>& member) noexcept {
+            queued_.fetch_add(1);
+            member.Wake();
+            if (!member.busy_.load()) {
+                return;
+            }
+            // The member is busy: hand the command to an idle sibling instead of letting it wait
+            ForEachSibling(member, [](Producer<T>& sibling) {
+                if (sibling.busy_.load()) {
+                    return false;
+                }
+                sibling.Wake();
+                return true;
+            });
+        }
+
+        void OnDequeued() noexcept { queued_.fetch_sub(1); }
+
+        // Takes up to half of the commands queued at the longest sibling queue, at most `maxItems` items
+        std::vector<ProcessCommand> Steal(Producer<T>& thief, size_t maxItems) {
+            Producer<T>* victim = nullptr;
+            size_t longest = 0;
+            ForEachSibling(thief, [&](Producer<T>& sibling) {
+                const size_t queued = sibling.pendingCount_.load();
+                if (queued > longest) {
+                    victim = &sibling;
+                    longest = queued;
+                }
+                return false;
+            });
+            if (victim == nullptr) {
+                return {};
+            }
+            auto batch = victim->PopPending(maxItems, (longest + 1) / 2);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                victim->TransferQueueDepth(thief);
+            }
+            if (!batch.empty()) {
+                FACTORY_LOG_INFO("[PRODUCER] ", thief.Name(), " stole ", batch.size(), " process command(s) from ", victim->Name());
+            }
+            return batch;
+        }
+
+        Data::MaterialHandle StealInput(Producer<T>& thief) {
+            Data::MaterialHandle item;
+            ForEachSibling(thief, [&](Producer<T>& sibling) {
+                item = sibling.TakeInput();
+                return static_cast<bool>(item);
+            });
+            return item;
+        }
+
+        Data::MaterialHandle TakeOutput(Data::MaterialKind kind, Producer<T>& requester) {
+            Data::MaterialHandle material;
+            ForEachSibling(requester, [&](Producer<T>& sibling) {
+                material = sibling.TakeOwnOutput(kind);
+                return static_cast<bool>(material);
+            });
+            return material;
+        }
+
+        bool Available(Data::MaterialKind kind, Producer<T>& requester) {
+            bool available = false;
+            ForEachSibling(requester, [&](Producer<T>& sibling) {
+                available = sibling.HasAvailable(kind);
+                return available;
+            });
+            return available;
+        }
+
+        // Claims a subscription for `kind` parked at a sibling of `source`
+        MaterialWaitPtr ClaimWaiter(Data::MaterialKind kind, Producer<T>& source) noexcept {
+            MaterialWaitPtr wait;
+            ForEachSibling(source, [&](Producer<T>& sibling) {
+                wait = sibling.ClaimOwnWaiter(kind);
+                return wait != nullptr;
+            });
+            return wait;
+        }
+
+    private:
+        // Visits every member except `self` until `fn` returns true
+        template<class Fn>
+        void ForEachSibling(const Producer<T>& self, Fn&& fn) {
+            const size_t count = size_.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; ++i) {
+                if (members_[i] != &self && fn(*members_[i])) {
+                    return;
+                }
+            }
+        }
+
+        std::array<Producer<T>*, MAX_GROUP_SIZE> members_{};
+        std::atomic<size_t> size_{0};
+        std::atomic<size_t> queued_{0};
+        std::mutex addMutex_;
     };
 }
 
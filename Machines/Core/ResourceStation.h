@@ -1,21 +1,53 @@
 #pragma once
 #include "MachineBase.hpp"
+#include "MaterialRing.hpp"
 #include "../../Shared.hpp"
 
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 namespace Factory::Machinery {
     class ResourceStation : public MachineBase {
     private:
-        std::unordered_map<Data::MaterialKind, std::queue<Data::AnyMaterial>> inventory_;
-        mutable std::mutex inventoryMutex_;
+        // Stock of one kind behind its own lock, so takes and generation of different kinds
+        // never contend. Padded to a cache line to keep the locks apart.
+        struct alignas(64) KindSlot {
+            mutable std::mutex mutex;
+            MaterialRing<Data::MaterialHandle> items; // payloads stay in the MaterialArena
+            InventoryBudget budget;
+            std::atomic<size_t> available{0}; // items in the ring, readable without the lock
+        };
+
+        std::array<KindSlot, Data::MATERIAL_KIND_COUNT> slots_;
+        MaterialWaiters waiters_; // each kind's queue guarded by that kind's slot lock
+
+        // Calls f(std::type_identity<T>{}) for the generated material type of `kind`
+        template<class F>
+        static decltype(auto) WithKind(Data::MaterialKind kind, F&& f) {
+            switch (kind) {
+                case Data::MaterialKind::MetalPipe: return f(std::type_identity<Data::MetalPipe>{});
+                case Data::MaterialKind::Gravel: return f(std::type_identity<Data::Gravel>{});
+                case Data::MaterialKind::TitaniumSlab: return f(std::type_identity<Data::TitaniumSlab>{});
+                case Data::MaterialKind::MetalPipeHalf:
+                    throw std::invalid_argument("[RESOURCE_STATION] cannot create halved item, use the cutter");
+                default:
+                    throw std::invalid_argument("[RESOURCE_STATION] invalid material kind");
+            }
+        }
+
+        KindSlot& Slot(Data::MaterialKind kind) { return slots_.at(static_cast<size_t>(kind)); }
+        const KindSlot& Slot(Data::MaterialKind kind) const { return slots_.at(static_cast<size_t>(kind)); }
 
     public:
         using MachineBase::MachineBase;
 
         // ResourceStation does not accept incoming materials
-        void TryReceive(Data::AnyMaterial&& /*material*/) override {
+        void TryReceive(Data::MaterialHandle&& /*material*/) override {
             throw std::invalid_argument("ResourceStation does not accept materials");
         }
 
@@ -23,59 +55,144 @@ namespace Factory::Machinery {
             return false;
         }
 
-        // Retrieve a material from inventory (thread-safe)
-        std::optional<Data::AnyMaterial> TakeMaterial(Data::MaterialKind kind) override {
-            std::lock_guard<std::mutex> lock(inventoryMutex_);
-            auto it = inventory_.find(kind);
-            if (it == inventory_.end() || it->second.empty()) {
-                return std::nullopt;
+        // Kinds OnGenerate can create; everything else only comes out of a producer
+        static constexpr bool Generates(Data::MaterialKind kind) noexcept {
+            return kind == Data::MaterialKind::MetalPipe || kind == Data::MaterialKind::Gravel
+                   || kind == Data::MaterialKind::TitaniumSlab;
+        }
+
+        // Retrieve a material from inventory (thread-safe); only the kind's own lock is taken
+        Data::MaterialHandle TakeMaterial(Data::MaterialKind kind) override {
+            if (!Generates(kind)) {
+                return {};
+            }
+            auto& slot = Slot(kind);
+            if (slot.available.load(std::memory_order_acquire) == 0) {
+                return {}; // empty kinds are answered without locking
             }
-            auto material = std::move(it->second.front());
-            it->second.pop();
-            std::cout << "[RESOURCE_STATION] " << Name() << " dispensed " 
-                      << Data::toString(kind) << std::endl;
-            return material;
+            std::optional<Data::MaterialHandle> material;
+            {
+                std::lock_guard<std::mutex> lock(slot.mutex);
+                material = slot.items.Pop();
+                if (!material) {
+                    return {};
+                }
+                slot.available.store(slot.items.Size(), std::memory_order_release);
+                slot.budget.Remove();
+            }
+            ReportStock(kind, -1);
+            FACTORY_LOG_INFO("[RESOURCE_STATION] ", Name(), " dispensed ", Data::toString(kind));
+            return std::move(*material);
         }
 
-        // Check if material is available (thread-safe)
+        // Check if material is available (thread-safe, lock-free)
         bool HasMaterial(Data::MaterialKind kind) const noexcept {
-            std::lock_guard<std::mutex> lock(inventoryMutex_);
-            auto it = inventory_.find(kind);
-            return it != inventory_.end() && !it->second.empty();
+            return kind < Data::MaterialKind::Invalid
+                   && slots_[static_cast<size_t>(kind)].available.load(std::memory_order_acquire) > 0;
         }
 
-           StepStatus OnGenerate(const GenerateResourceCommand &c) override {
-            std::lock_guard<std::mutex> lock(inventoryMutex_);
-            switch(c.material_kind) {
-                case Data::MaterialKind::MetalPipe: {
-                    auto material = Data::MetalPipe{Data::DataBuffer(1024)};
-                    inventory_[c.material_kind].emplace(std::move(material));
-//                    std::cout << "[RESOURCE_STATION] " << Name() << " created MetalPipe" << std::endl;
-                    break;
-                }
-                case Data::MaterialKind::Gravel: {
-                    auto material = Data::Gravel{Data::DataBuffer(4096)};
-                    inventory_[c.material_kind].emplace(std::move(material));
-//                    std::cout << "[RESOURCE_STATION] " << Name() << " created Gravel" << std::endl;
-                    break;
-                }
-                case Data::MaterialKind::TitaniumSlab: {
-                    auto material = Data::TitaniumSlab{Data::DataBuffer(2048)};
-                    inventory_[c.material_kind].emplace(std::move(material));
-//                    std::cout << "[RESOURCE_STATION] " << Name() << " created TitaniumSlab" << std::endl;
-                    break;
+        // Number of items of a kind in stock (thread-safe, lock-free)
+        size_t Stock(Data::MaterialKind kind) const {
+            return Slot(kind).available.load(std::memory_order_acquire);
+        }
+
+        /** Sets capacity and generation throttling band for one kind (thread-safe).
+         * @throws std::invalid_argument on an invalid kind or inconsistent limit
+         */
+        void SetLimit(Data::MaterialKind kind, const InventoryLimit& limit) {
+            if (kind >= Data::MaterialKind::Invalid) {
+                throw std::invalid_argument("[RESOURCE_STATION] invalid material kind");
+            }
+            auto& slot = Slot(kind);
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            slot.budget.SetLimit(limit);
+        }
+
+        // False while the kind is at capacity or above its high watermark (thread-safe)
+        bool AcceptsGeneration(Data::MaterialKind kind) const {
+            const auto& slot = Slot(kind);
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            return slot.budget.HasSpace();
+        }
+
+        std::vector<Occupancy> GetOccupancy() const override {
+            std::vector<Occupancy> result;
+            for (size_t i = 0; i < slots_.size(); ++i) {
+                std::lock_guard<std::mutex> lock(slots_[i].mutex);
+                auto snapshot = slots_[i].budget.Snapshot(static_cast<Data::MaterialKind>(i));
+                if (snapshot.stored > 0 || snapshot.capacity != UNBOUNDED) {
+                    result.push_back(snapshot);
                 }
-                case Data::MaterialKind::MetalPipeHalf: {
-                    throw std::invalid_argument("[RESOURCE_STATION] cannot create halved item, use the cutter");
+            }
+            return result;
+        }
+
+        bool NotifyWhenAvailable(Data::MaterialKind kind, const MaterialWaitPtr& wait) override {
+            {
+                auto& slot = Slot(kind);
+                std::lock_guard<std::mutex> lock(slot.mutex);
+                if (slot.available.load(std::memory_order_relaxed) == 0) {
+                    waiters_.Add(kind, wait);
+                    return true;
                 }
-                default: {
-                    throw std::invalid_argument("[RESOURCE_STATION] invalid material kind");
+            }
+            if (wait->TryClaim()) {
+                MaterialWaiters::Fire(wait);
+            }
+            return true;
+        }
+
+        StepStatus OnGenerate(const GenerateResourceCommand &c) override {
+            MaterialWaitPtr woken;
+            const StepStatus status = WithKind(c.material_kind, [&]<class T>(std::type_identity<T>) {
+                auto& slot = Slot(T::kind);
+                std::lock_guard<std::mutex> lock(slot.mutex);
+                // Backpressure: a full kind is not generated rather than dropped later
+                if (slot.budget.Full()) {
+                    FACTORY_LOG_DEBUG("[RESOURCE_STATION] ", Name(), " is full for ", Data::toString(T::kind));
+                    return BLOCKED;
                 }
+                slot.items.Push(Data::MaterialArena::Instance().Create(T{Data::DataBuffer(PayloadSize<T>())}));
+                slot.available.store(slot.items.Size(), std::memory_order_release);
+                slot.budget.Add();
+                woken = waiters_.ClaimOne(T::kind);
+                FACTORY_LOG_DEBUG("[RESOURCE_STATION] ", Name(), " created ", Data::toString(T::kind));
+                return SUCCESS;
+            });
+            if (status == SUCCESS) {
+                ReportStock(c.material_kind, +1);
             }
-            return SUCCESS;
+            // Wake a step parked on this kind outside the lock
+            MaterialWaiters::Fire(woken);
+            return status;
+        }
+
+        /** Puts generated kinds back into stock, past the kind's limit if need be.
+         * @throws std::invalid_argument for a kind the station does not generate
+         * @throws std::bad_alloc
+         * Exception guarantee: basic
+         */
+        void Restock(Data::MaterialKind kind, size_t count) override {
+            MaterialWaitPtr woken;
+            WithKind(kind, [&]<class T>(std::type_identity<T>) {
+                auto& slot = Slot(T::kind);
+                std::lock_guard<std::mutex> lock(slot.mutex);
+                for (size_t i = 0; i < count; ++i) {
+                    slot.items.Push(Data::MaterialArena::Instance().Create(T{Data::DataBuffer(PayloadSize<T>())}));
+                    slot.available.store(slot.items.Size(), std::memory_order_release);
+                    slot.budget.Add();
+                }
+                woken = waiters_.ClaimOne(T::kind);
+            });
+            MaterialWaiters::Fire(woken);
+            FACTORY_LOG_INFO("[RESOURCE_STATION] ", Name(), " restocked ", count, " ", Data::toString(kind));
         }
 
+    private:
+        // Payload bytes of a freshly generated item
+        template<class T>
+        static constexpr size_t PayloadSize() noexcept {
+            return Data::payloadSizeOf(T::kind);
+        }
     };
 }
-
-
@@ -3,21 +3,29 @@
 #include "../MachineConepts.hpp"
 
 #include <concepts>
-#include <iostream>
+#include <utility>
 
 namespace Factory::Machinery {
+    // Simulated time of a cutting cycle (milliseconds): blade setup once, then each cut.
+    // A single cut costs CUT_SETUP_MS + CUT_PER_ITEM_MS.
+    inline constexpr int CUT_SETUP_MS = 2000;
+    inline constexpr int CUT_PER_ITEM_MS = 1000;
+
     template<Data::Cuttable T>
     class Cutter : public Producer<T> {
     public:
-        using Producer<T>::Producer;
+        using OutputType = decltype(std::declval<T&>().cutInHalf());
+
+        explicit Cutter(std::string name) : Producer<T>(std::move(name)) {
+            this->SetCostModel({std::chrono::milliseconds(CUT_SETUP_MS), std::chrono::milliseconds(CUT_PER_ITEM_MS)});
+        }
 
     private:
         void ProcessOne(T&& item) override {
             auto out = item.cutInHalf();
-            std::this_thread::sleep_for(std::chrono::milliseconds(3000));
             // Store output for potential later pickup/transport
-            this->Emit(Data::AnyMaterial{std::move(out)});
-            std::cout << "[PRODUCER] " << this->Name() << " processed material_kind=" << Data::toString(T::kind) << std::endl;
+            this->Emit(std::move(out));
+            FACTORY_LOG_INFO("[PRODUCER] ", this->Name(), " processed material_kind=", Data::toString(T::kind));
         }
     };
 }
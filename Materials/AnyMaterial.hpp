@@ -1,19 +1,24 @@
 #pragma once
 
+#include "BufferPool.hpp"
+
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <variant>
 
 namespace Factory::Data {
 
+    // Material payload; storage comes from, and returns to, the shared BufferPool
     class DataBuffer {
     private:
         char* data_ = nullptr;
         size_t size_ = 0;
 
     public:
-        DataBuffer(size_t size) : data_(new char[size]), size_(size) {}
-        ~DataBuffer() { delete[] data_; }
+        DataBuffer(size_t size)
+            : data_(static_cast<char*>(BufferPool::Instance().Allocate(size))), size_(size) {}
+        ~DataBuffer() { BufferPool::Instance().Deallocate(data_, size_); }
 
         DataBuffer(const DataBuffer&) = delete;
         DataBuffer& operator=(const DataBuffer&) = delete;
@@ -25,7 +30,7 @@ namespace Factory::Data {
 
         DataBuffer& operator=(DataBuffer&& other) noexcept {
             if (this != &other) {
-                delete[] data_;
+                BufferPool::Instance().Deallocate(data_, size_);
                 data_ = other.data_;
                 size_ = other.size_;
                 other.data_ = nullptr;
@@ -43,6 +48,9 @@ namespace Factory::Data {
         Invalid,
     };
 
+    // Number of valid material kinds; MaterialKind values below this index dense arrays
+    inline constexpr size_t MATERIAL_KIND_COUNT = static_cast<size_t>(MaterialKind::Invalid);
+
     inline std::string toString(MaterialKind kind) {
         switch (kind) {
             case MaterialKind::MetalPipe: return "MetalPipe";
@@ -54,6 +62,16 @@ namespace Factory::Data {
         return "Unknown";
     }
 
+    // Payload bytes of a freshly made item of a kind
+    constexpr size_t payloadSizeOf(MaterialKind kind) noexcept {
+        switch (kind) {
+            case MaterialKind::MetalPipe: return 1024;
+            case MaterialKind::Gravel: return 4096;
+            case MaterialKind::MetalPipeHalf: return 512;
+            default: return 2048;
+        }
+    }
+
     struct MetalPipeHalf {
         DataBuffer data;
         static constexpr MaterialKind kind = MaterialKind::MetalPipeHalf;
@@ -64,7 +82,7 @@ namespace Factory::Data {
         static constexpr MaterialKind kind = MaterialKind::MetalPipe;
 
         MetalPipeHalf cutInHalf() {
-            return MetalPipeHalf{Data::DataBuffer{512}};
+            return MetalPipeHalf{Data::DataBuffer{payloadSizeOf(MaterialKind::MetalPipeHalf)}};
         }
     };
 
@@ -85,6 +103,21 @@ namespace Factory::Data {
     inline MaterialKind kind_of(const AnyMaterial& m) {
         return std::visit([](const auto& v) { return std::decay_t<decltype(v)>::kind; }, m);
     }
+
+    /** Makes an item of any valid kind with a fresh payload, e.g. to restock a machine after a restart.
+     * @throws std::invalid_argument for MaterialKind::Invalid
+     * @throws std::bad_alloc
+     */
+    inline AnyMaterial makeMaterial(MaterialKind kind) {
+        switch (kind) {
+            case MaterialKind::MetalPipe: return MetalPipe{DataBuffer(payloadSizeOf(kind))};
+            case MaterialKind::Gravel: return Gravel{DataBuffer(payloadSizeOf(kind))};
+            case MaterialKind::TitaniumSlab: return TitaniumSlab{DataBuffer(payloadSizeOf(kind))};
+            case MaterialKind::MetalPipeHalf: return MetalPipeHalf{DataBuffer(payloadSizeOf(kind))};
+            case MaterialKind::Invalid: break;
+        }
+        throw std::invalid_argument("cannot make a material of an invalid kind");
+    }
 }
 
 
@@ -0,0 +1,144 @@
+#include "BufferPool.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace Factory::Data {
+
+    // Per-thread block cache; hands its blocks back to the shared lists on thread exit
+    struct BufferPool::ThreadCache {
+        std::array<std::vector<void*>, SIZE_CLASSES.size()> blocks;
+
+        ~ThreadCache() {
+            auto& pool = BufferPool::Instance();
+            for (size_t i = 0; i < blocks.size(); ++i) {
+                pool.Spill(i, blocks[i], 0);
+            }
+        }
+    };
+
+    BufferPool& BufferPool::Instance() {
+        static BufferPool pool;
+        return pool;
+    }
+
+    BufferPool::~BufferPool() {
+        for (auto& sc : classes_) {
+            for (void* block : sc.freeList) {
+                ::operator delete(block);
+            }
+        }
+    }
+
+    size_t BufferPool::ClassIndex(size_t size) noexcept {
+        for (size_t i = 0; i < SIZE_CLASSES.size(); ++i) {
+            if (size <= SIZE_CLASSES[i]) {
+                return i;
+            }
+        }
+        return NO_CLASS;
+    }
+
+    BufferPool::ThreadCache* BufferPool::LocalCache() noexcept {
+        Instance(); // the pool must be constructed before, and so destroyed after, the cache
+        thread_local ThreadCache cache;
+        return &cache;
+    }
+
+    void* BufferPool::Allocate(size_t size) {
+        const size_t index = ClassIndex(size);
+        if (index == NO_CLASS) {
+            return ::operator new(size);
+        }
+
+        auto& sc = classes_[index];
+        auto& local = LocalCache()->blocks[index];
+        if (local.empty()) {
+            Refill(index, local);
+        }
+
+        void* block;
+        if (!local.empty()) {
+            block = local.back();
+            local.pop_back();
+            sc.hits.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            block = ::operator new(SIZE_CLASSES[index]);
+            sc.misses.fetch_add(1, std::memory_order_relaxed);
+        }
+        TrackLive(sc);
+        return block;
+    }
+
+    void BufferPool::Deallocate(void* block, size_t size) noexcept {
+        if (block == nullptr) {
+            return;
+        }
+        const size_t index = ClassIndex(size);
+        if (index == NO_CLASS) {
+            ::operator delete(block);
+            return;
+        }
+
+        classes_[index].live.fetch_sub(1, std::memory_order_relaxed);
+        auto& local = LocalCache()->blocks[index];
+        try {
+            local.push_back(block);
+        } catch (...) {
+            ::operator delete(block);
+            return;
+        }
+        if (local.size() > LOCAL_CACHE_LIMIT) {
+            Spill(index, local, LOCAL_CACHE_LIMIT - TRANSFER_BATCH);
+        }
+    }
+
+    std::vector<PoolStats> BufferPool::Stats() const {
+        std::vector<PoolStats> stats;
+        stats.reserve(classes_.size());
+        for (size_t i = 0; i < classes_.size(); ++i) {
+            const auto& sc = classes_[i];
+            size_t cached;
+            {
+                std::lock_guard<std::mutex> lock(sc.mutex);
+                cached = sc.freeList.size();
+            }
+            stats.push_back(PoolStats{
+                SIZE_CLASSES[i],
+                sc.hits.load(std::memory_order_relaxed),
+                sc.misses.load(std::memory_order_relaxed),
+                sc.live.load(std::memory_order_relaxed),
+                sc.highWater.load(std::memory_order_relaxed),
+                cached,
+            });
+        }
+        return stats;
+    }
+
+    void BufferPool::Refill(size_t index, std::vector<void*>& local) {
+        auto& sc = classes_[index];
+        std::lock_guard<std::mutex> lock(sc.mutex);
+        const size_t count = std::min(TRANSFER_BATCH, sc.freeList.size());
+        local.insert(local.end(), sc.freeList.end() - static_cast<std::ptrdiff_t>(count), sc.freeList.end());
+        sc.freeList.resize(sc.freeList.size() - count);
+    }
+
+    void BufferPool::Spill(size_t index, std::vector<void*>& local, size_t keep) noexcept {
+        auto& sc = classes_[index];
+        std::lock_guard<std::mutex> lock(sc.mutex);
+        while (local.size() > keep) {
+            try {
+                sc.freeList.push_back(local.back());
+            } catch (...) {
+                ::operator delete(local.back());
+            }
+            local.pop_back();
+        }
+    }
+
+    void BufferPool::TrackLive(SizeClass& sc) noexcept {
+        const size_t live = sc.live.fetch_add(1, std::memory_order_relaxed) + 1;
+        size_t high = sc.highWater.load(std::memory_order_relaxed);
+        while (live > high && !sc.highWater.compare_exchange_weak(high, live, std::memory_order_relaxed)) {}
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Factory::Data {
+
+    struct PoolStats {
+        size_t blockSize;
+        std::uint64_t hits;      // requests served from a cached block
+        std::uint64_t misses;    // requests that had to allocate a new block
+        size_t live;             // blocks currently handed out
+        size_t highWater;        // maximum of `live` since start
+        size_t cached;           // blocks parked in the shared free list
+
+        double HitRate() const noexcept {
+            auto total = hits + misses;
+            return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+        }
+    };
+
+    /**
+     * Thread-safe size-class pool for material payloads.
+     * Requests are rounded up to the next size class (512, 1024, 2048, 4096 bytes).
+     * Each thread keeps a small cache per class and exchanges blocks with the shared
+     * free lists in batches, so the common allocate/release path takes no lock.
+     * Larger requests bypass the pool.
+     */
+    class BufferPool {
+    public:
+        static constexpr std::array<size_t, 4> SIZE_CLASSES{512, 1024, 2048, 4096};
+        static constexpr size_t LOCAL_CACHE_LIMIT = 32;   // blocks per class per thread
+        static constexpr size_t TRANSFER_BATCH = 16;      // blocks moved per refill/spill
+
+        static BufferPool& Instance();
+
+        ~BufferPool();
+
+        BufferPool(const BufferPool&) = delete;
+        BufferPool& operator=(const BufferPool&) = delete;
+
+        /** Returns a block of at least `size` bytes.
+         *
+         * @throws std::bad_alloc if a new block cannot be allocated
+         * Exception guarantee: strong
+         */
+        void* Allocate(size_t size);
+
+        /** Returns a block obtained from Allocate(size) to the pool.
+         *
+         * Exception guarantee: no-throw
+         */
+        void Deallocate(void* block, size_t size) noexcept;
+
+        std::vector<PoolStats> Stats() const;
+
+    private:
+        BufferPool() = default;
+
+        struct ThreadCache;
+
+        struct SizeClass {
+            mutable std::mutex mutex;
+            std::vector<void*> freeList;
+            std::atomic<std::uint64_t> hits{0};
+            std::atomic<std::uint64_t> misses{0};
+            std::atomic<size_t> live{0};
+            std::atomic<size_t> highWater{0};
+        };
+
+        static constexpr size_t NO_CLASS = SIZE_CLASSES.size();
+        static size_t ClassIndex(size_t size) noexcept;
+        static ThreadCache* LocalCache() noexcept;
+
+        void Refill(size_t index, std::vector<void*>& local);
+        void Spill(size_t index, std::vector<void*>& local, size_t keep) noexcept;
+        void TrackLive(SizeClass& sc) noexcept;
+
+        std::array<SizeClass, SIZE_CLASSES.size()> classes_;
+    };
+}
@@ -0,0 +1,105 @@
+#include "MaterialArena.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Factory::Data {
+
+    // Per-thread cache of free slots; hands them back to the shared list on thread exit
+    struct MaterialArena::ThreadCache {
+        std::vector<std::uint32_t> slots;
+
+        ~ThreadCache() { MaterialArena::Instance().Spill(slots, 0); }
+    };
+
+    MaterialArena::MaterialArena() {
+        BufferPool::Instance(); // payloads free into the pool, so it must outlive the arena
+    }
+
+    MaterialArena& MaterialArena::Instance() {
+        static MaterialArena arena;
+        return arena;
+    }
+
+    MaterialArena::ThreadCache* MaterialArena::LocalCache() noexcept {
+        Instance(); // the arena must be constructed before, and so destroyed after, the cache
+        thread_local ThreadCache cache;
+        return &cache;
+    }
+
+    std::uint32_t MaterialArena::AllocateSlot() {
+        auto& local = LocalCache()->slots;
+        if (local.empty()) {
+            Refill(local);
+        }
+        const std::uint32_t index = local.back();
+        local.pop_back();
+        return index;
+    }
+
+    void MaterialArena::Release(MaterialId id) noexcept {
+        auto& slot = SlotAt(id.Slot());
+        slot.payload.reset();
+        slot.parent = {};
+        slot.generation = (slot.generation + 1) & MaterialId::GENERATION_MASK;
+        if (slot.generation == 0) {
+            slot.generation = 1;
+        }
+        live_.fetch_sub(1, std::memory_order_relaxed);
+
+        auto& local = LocalCache()->slots;
+        try {
+            local.push_back(id.Slot());
+        } catch (...) {
+            // Out of memory: the slot is leaked, the material itself is still destroyed
+            return;
+        }
+        if (local.size() > LOCAL_CACHE_LIMIT) {
+            Spill(local, LOCAL_CACHE_LIMIT - TRANSFER_BATCH);
+        }
+    }
+
+    void MaterialArena::Refill(std::vector<std::uint32_t>& local) {
+        local.reserve(LOCAL_CACHE_LIMIT + 1);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (freeList_.empty()) {
+            // Carve a new chunk into the shared list
+            const size_t chunk = chunkCount_.load(std::memory_order_relaxed);
+            if (chunk == MAX_CHUNKS) {
+                throw std::length_error("[ARENA] material arena is full");
+            }
+            chunks_[chunk] = std::make_unique<Slot[]>(CHUNK_SLOTS);
+            freeList_.reserve(freeList_.size() + CHUNK_SLOTS);
+            for (size_t i = CHUNK_SLOTS; i-- > 0;) {
+                freeList_.push_back(static_cast<std::uint32_t>(chunk * CHUNK_SLOTS + i));
+            }
+            chunkCount_.store(chunk + 1, std::memory_order_relaxed);
+        }
+        const size_t count = std::min(TRANSFER_BATCH, freeList_.size());
+        local.insert(local.end(), freeList_.end() - static_cast<std::ptrdiff_t>(count), freeList_.end());
+        freeList_.resize(freeList_.size() - count);
+    }
+
+    void MaterialArena::Spill(std::vector<std::uint32_t>& local, size_t keep) noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (local.size() > keep) {
+            try {
+                freeList_.push_back(local.back());
+            } catch (...) {
+                return; // keep the rest cached rather than losing them
+            }
+            local.pop_back();
+        }
+    }
+
+    void MaterialArena::TrackLive() noexcept {
+        const size_t live = live_.fetch_add(1, std::memory_order_relaxed) + 1;
+        size_t high = highWater_.load(std::memory_order_relaxed);
+        while (live > high && !highWater_.compare_exchange_weak(high, live, std::memory_order_relaxed)) {}
+    }
+
+    ArenaStats MaterialArena::Stats() const noexcept {
+        return ArenaStats{live_.load(std::memory_order_relaxed), highWater_.load(std::memory_order_relaxed),
+                          chunkCount_.load(std::memory_order_relaxed) * CHUNK_SLOTS};
+    }
+}
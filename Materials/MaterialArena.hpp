@@ -0,0 +1,192 @@
+#pragma once
+
+#include "AnyMaterial.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Factory::Data {
+
+    /**
+     * Identity of one material for its whole life: arena slot, slot generation and kind
+     * packed into 64 bits. A slot's generation changes whenever it is freed, so the id of a
+     * consumed material is not reissued (until the 24-bit generation wraps) and stays
+     * meaningful for lineage.
+     */
+    class MaterialId {
+    public:
+        constexpr MaterialId() noexcept = default;
+
+        constexpr std::uint64_t Value() const noexcept { return value_; }
+
+        constexpr MaterialKind Kind() const noexcept {
+            return value_ == 0 ? MaterialKind::Invalid : static_cast<MaterialKind>(value_ >> KIND_SHIFT);
+        }
+
+        constexpr explicit operator bool() const noexcept { return value_ != 0; }
+
+        friend constexpr bool operator==(MaterialId, MaterialId) noexcept = default;
+
+    private:
+        friend class MaterialArena;
+
+        static constexpr unsigned GENERATION_SHIFT = 32;
+        static constexpr unsigned KIND_SHIFT = 56;
+        static constexpr std::uint32_t GENERATION_MASK = (1u << (KIND_SHIFT - GENERATION_SHIFT)) - 1;
+
+        constexpr MaterialId(std::uint32_t slot, std::uint32_t generation, MaterialKind kind) noexcept
+            : value_(static_cast<std::uint64_t>(slot) | static_cast<std::uint64_t>(generation) << GENERATION_SHIFT
+                     | static_cast<std::uint64_t>(kind) << KIND_SHIFT) {}
+
+        constexpr std::uint32_t Slot() const noexcept { return static_cast<std::uint32_t>(value_); }
+
+        constexpr std::uint32_t Generation() const noexcept {
+            return static_cast<std::uint32_t>(value_ >> GENERATION_SHIFT) & GENERATION_MASK;
+        }
+
+        std::uint64_t value_{0};
+    };
+
+    /**
+     * Sole owner of one material stored in the MaterialArena.
+     * Eight bytes, move-only: handing a material to another machine moves the handle and
+     * leaves the payload where it is. Dropping the handle destroys the material.
+     */
+    class MaterialHandle {
+    public:
+        MaterialHandle() noexcept = default;
+
+        MaterialHandle(MaterialHandle&& other) noexcept : id_(std::exchange(other.id_, {})) {}
+
+        MaterialHandle& operator=(MaterialHandle&& other) noexcept {
+            if (this != &other) {
+                Reset();
+                id_ = std::exchange(other.id_, {});
+            }
+            return *this;
+        }
+
+        MaterialHandle(const MaterialHandle&) = delete;
+        MaterialHandle& operator=(const MaterialHandle&) = delete;
+
+        ~MaterialHandle() { Reset(); }
+
+        MaterialId Id() const noexcept { return id_; }
+
+        // Known without touching the arena; Invalid for an empty handle
+        MaterialKind Kind() const noexcept { return id_.Kind(); }
+
+        explicit operator bool() const noexcept { return static_cast<bool>(id_); }
+
+    private:
+        friend class MaterialArena;
+
+        explicit MaterialHandle(MaterialId id) noexcept : id_(id) {}
+
+        void Reset() noexcept;
+
+        MaterialId id_;
+    };
+
+    struct ArenaStats {
+        size_t live;      // materials currently stored
+        size_t highWater; // maximum of `live` since start
+        size_t slots;     // slots allocated, live or free
+    };
+
+    /**
+     * Central store owning the payload of every material in the factory.
+     * A payload is constructed once when its material is created and destroyed once when the
+     * last handle lets go of it; machines and commands only pass MaterialHandles around.
+     * Each material records the material it was made from, e.g. the pipe a half was cut from.
+     *
+     * Slots live in fixed chunks that never move, so a payload is reached without a lock.
+     * Free slots are cached per thread like BufferPool blocks; only refills and spills of
+     * those caches take the arena lock.
+     */
+    class MaterialArena {
+    public:
+        static constexpr size_t CHUNK_SLOTS = 4096;
+        static constexpr size_t MAX_CHUNKS = 4096;        // up to 16M live materials
+        static constexpr size_t LOCAL_CACHE_LIMIT = 64;   // free slots per thread
+        static constexpr size_t TRANSFER_BATCH = 32;      // free slots moved per refill/spill
+
+        static MaterialArena& Instance();
+
+        MaterialArena(const MaterialArena&) = delete;
+        MaterialArena& operator=(const MaterialArena&) = delete;
+
+        /** Stores a material and returns the handle owning it.
+         * @param parent the material this one was made from, if any
+         * @throws std::bad_alloc, or std::length_error once MAX_CHUNKS chunks are full
+         * Exception guarantee: strong
+         */
+        template<class T>
+            requires std::is_constructible_v<AnyMaterial, T&&> && (!std::is_lvalue_reference_v<T>)
+        MaterialHandle Create(T&& payload, MaterialId parent = {}) {
+            const std::uint32_t index = AllocateSlot();
+            auto& slot = SlotAt(index);
+            slot.payload.emplace(std::forward<T>(payload));
+            slot.parent = parent;
+            TrackLive();
+            return MaterialHandle(MaterialId(index, slot.generation, kind_of(*slot.payload)));
+        }
+
+        // Payload of a live material; only the owner of the handle may use it
+        AnyMaterial& Get(const MaterialHandle& handle) noexcept { return *SlotAt(handle.Id().Slot()).payload; }
+
+        // Payload of a live material of kind T::kind
+        template<class T>
+        T& Get(const MaterialHandle& handle) noexcept { return *std::get_if<T>(&Get(handle)); }
+
+        // The material a live material was made from; empty for raw materials
+        MaterialId ParentOf(const MaterialHandle& handle) const noexcept { return SlotAt(handle.Id().Slot()).parent; }
+
+        ArenaStats Stats() const noexcept;
+
+    private:
+        friend class MaterialHandle;
+
+        struct Slot {
+            std::optional<AnyMaterial> payload;
+            MaterialId parent;
+            std::uint32_t generation{1}; // never 0, so no live id is 0
+        };
+
+        struct ThreadCache;
+
+        MaterialArena();
+
+        static ThreadCache* LocalCache() noexcept;
+
+        Slot& SlotAt(std::uint32_t index) noexcept { return chunks_[index / CHUNK_SLOTS][index % CHUNK_SLOTS]; }
+        const Slot& SlotAt(std::uint32_t index) const noexcept { return chunks_[index / CHUNK_SLOTS][index % CHUNK_SLOTS]; }
+
+        std::uint32_t AllocateSlot();
+        void Release(MaterialId id) noexcept;
+        void Refill(std::vector<std::uint32_t>& local);
+        void Spill(std::vector<std::uint32_t>& local, size_t keep) noexcept;
+        void TrackLive() noexcept;
+
+        std::array<std::unique_ptr<Slot[]>, MAX_CHUNKS> chunks_;
+        std::mutex mutex_; // guards freeList_ and chunk allocation
+        std::vector<std::uint32_t> freeList_;
+        std::atomic<size_t> chunkCount_{0};
+        std::atomic<size_t> live_{0};
+        std::atomic<size_t> highWater_{0};
+    };
+
+    inline void MaterialHandle::Reset() noexcept {
+        if (id_) {
+            MaterialArena::Instance().Release(std::exchange(id_, {}));
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#include "FactoryMetrics.hpp"
+#include "../Logging/Logger.hpp"
+#include "../Materials/AnyMaterial.hpp"
+
+#include <exception>
+
+namespace Factory::Metrics {
+
+    namespace {
+        double Milliseconds(std::uint64_t nanoseconds) noexcept {
+            return static_cast<double>(nanoseconds) / 1e6;
+        }
+
+        void LogLatency(const char* prefix, std::string_view subject, const char* what,
+                        const HistogramSnapshot& h) noexcept {
+            FACTORY_LOG_INFO(prefix, subject, " ", what, ": n ", h.count, " mean ", Milliseconds(h.mean),
+                             "ms p50 ", Milliseconds(h.p50), "ms p90 ", Milliseconds(h.p90), "ms p99 ",
+                             Milliseconds(h.p99), "ms p99.9 ", Milliseconds(h.p999), "ms max ",
+                             Milliseconds(h.max), "ms");
+        }
+    }
+
+    void LogMetrics(const FactoryMetrics& metrics) noexcept {
+        try {
+            for (const auto& machine : metrics.machines) {
+                FACTORY_LOG_INFO("[METRICS] ", machine.name, ": queue depth ", machine.queueDepth, " (max ",
+                                 machine.maxQueueDepth, ") utilization ", machine.utilization * 100.0, "%");
+                if (machine.queueWait.count > 0) {
+                    LogLatency("[METRICS] ", machine.name, "queue wait", machine.queueWait);
+                }
+                for (size_t t = 0; t < COMMAND_TYPE_COUNT; ++t) {
+                    if (machine.service[t].count == 0) {
+                        continue;
+                    }
+                    const auto type = static_cast<CommandType>(t);
+                    LogLatency("[METRICS] ", machine.name, toString(type), machine.service[t]);
+                    const auto& outcomes = machine.outcomes[t];
+                    FACTORY_LOG_INFO("[METRICS] ", machine.name, " ", toString(type), " outcomes: ",
+                                     toString(SUCCESS), " ", outcomes[SUCCESS], " ", toString(RETRY), " ",
+                                     outcomes[RETRY], " ", toString(BLOCKED), " ", outcomes[BLOCKED], " ",
+                                     toString(ERROR), " ", outcomes[ERROR]);
+                }
+                for (const auto& occupancy : machine.occupancy) {
+                    if (occupancy.capacity == Machinery::UNBOUNDED) {
+                        FACTORY_LOG_INFO("[OCCUPANCY] ", machine.name, " ", Data::toString(occupancy.kind), ": stored ",
+                                         occupancy.stored, " reserved ", occupancy.reserved, " capacity unbounded");
+                        continue;
+                    }
+                    FACTORY_LOG_INFO("[OCCUPANCY] ", machine.name, " ", Data::toString(occupancy.kind), ": stored ",
+                                     occupancy.stored, " reserved ", occupancy.reserved, " capacity ",
+                                     occupancy.capacity, occupancy.throttled ? " (throttled)" : "");
+                }
+            }
+            FACTORY_LOG_INFO("[METRICS] jobs: finished ", metrics.jobsFinished, " failed ", metrics.jobsFailed,
+                             " workers ", metrics.workers);
+            if (metrics.jobLatency.count > 0) {
+                LogLatency("[METRICS] ", "jobs", "end-to-end latency", metrics.jobLatency);
+            }
+        } catch (const std::exception& e) {
+            FACTORY_LOG_ERROR("[ERROR] Failed to report metrics with error: ", e.what());
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Histogram.hpp"
+#include "MachineMetrics.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Factory::Metrics {
+
+    // Everything the Controller can report in one snapshot: its machines, in registration order,
+    // and job end-to-end latency from submission to completion
+    struct FactoryMetrics {
+        std::vector<MachineMetricsSnapshot> machines;
+        HistogramSnapshot jobLatency; // successful jobs only
+        std::uint64_t jobsFinished{0};
+        std::uint64_t jobsFailed{0};
+        size_t workers{0};
+    };
+
+    /** Writes a snapshot to the log, one line per machine, command type and inventory kind.
+     *
+     * Exception guarantee: no-throw
+     */
+    void LogMetrics(const FactoryMetrics& metrics) noexcept;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "../Clock.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace Factory::Metrics {
+
+    // Monotonic event counter; relaxed increments only
+    class Counter {
+    public:
+        void Add(std::uint64_t n = 1) noexcept { value_.fetch_add(n, std::memory_order_relaxed); }
+
+        std::uint64_t Value() const noexcept { return value_.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<std::uint64_t> value_{0};
+    };
+
+    // Point-in-time summary of a Histogram; latencies in nanoseconds
+    struct HistogramSnapshot {
+        std::uint64_t count{0};
+        std::uint64_t mean{0};
+        std::uint64_t p50{0};
+        std::uint64_t p90{0};
+        std::uint64_t p99{0};
+        std::uint64_t p999{0};
+        std::uint64_t max{0};
+    };
+
+    /**
+     * Lock-free latency histogram with HDR-style log-linear buckets.
+     * Values below SUB_BUCKETS are counted exactly; every power-of-two range above is split
+     * into SUB_BUCKETS equal buckets, so a reported percentile is at most 1/SUB_BUCKETS
+     * (about 6%) above the true value. Values from 2^MAX_MAGNITUDE ns (about 78 hours) up
+     * land in the last bucket.
+     *
+     * Record is three relaxed increments plus a compare-and-swap when a new maximum is seen,
+     * so it is cheap enough to stay enabled on every command. Snapshots taken while others
+     * record are approximate but never torn per bucket.
+     */
+    class Histogram {
+    public:
+        static constexpr unsigned SUB_BUCKET_BITS = 4;
+        static constexpr std::uint64_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+        static constexpr unsigned MAX_MAGNITUDE = 48;
+        static constexpr size_t BUCKET_COUNT = SUB_BUCKETS + (MAX_MAGNITUDE - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+        void Record(std::uint64_t value) noexcept {
+            buckets_[IndexOf(value)].fetch_add(1, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+            sum_.fetch_add(value, std::memory_order_relaxed);
+            auto max = max_.load(std::memory_order_relaxed);
+            while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+        }
+
+        // Negative durations (clock adjustments) count as zero
+        void Record(Clock::Duration duration) noexcept {
+            Record(static_cast<std::uint64_t>(std::max<Clock::Duration::rep>(duration.count(), 0)));
+        }
+
+        std::uint64_t Count() const noexcept { return count_.load(std::memory_order_relaxed); }
+
+        HistogramSnapshot Snapshot() const noexcept {
+            HistogramSnapshot snapshot;
+            std::array<std::uint64_t, BUCKET_COUNT> counts;
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                counts[i] = buckets_[i].load(std::memory_order_relaxed);
+                snapshot.count += counts[i];
+            }
+            if (snapshot.count == 0) {
+                return snapshot;
+            }
+            snapshot.mean = sum_.load(std::memory_order_relaxed) / std::max<std::uint64_t>(Count(), 1);
+            snapshot.max = max_.load(std::memory_order_relaxed);
+            snapshot.p50 = Percentile(counts, snapshot.count, 0.50, snapshot.max);
+            snapshot.p90 = Percentile(counts, snapshot.count, 0.90, snapshot.max);
+            snapshot.p99 = Percentile(counts, snapshot.count, 0.99, snapshot.max);
+            snapshot.p999 = Percentile(counts, snapshot.count, 0.999, snapshot.max);
+            return snapshot;
+        }
+
+        static constexpr size_t IndexOf(std::uint64_t value) noexcept {
+            if (value < SUB_BUCKETS) {
+                return static_cast<size_t>(value);
+            }
+            const unsigned magnitude = std::min<unsigned>(std::bit_width(value) - 1, MAX_MAGNITUDE - 1);
+            const unsigned shift = magnitude - SUB_BUCKET_BITS;
+            const std::uint64_t sub = std::min<std::uint64_t>((value >> shift) - SUB_BUCKETS, SUB_BUCKETS - 1);
+            return static_cast<size_t>(SUB_BUCKETS + shift * SUB_BUCKETS + sub);
+        }
+
+        // Highest value that falls into bucket `index`
+        static constexpr std::uint64_t UpperBound(size_t index) noexcept {
+            if (index < SUB_BUCKETS) {
+                return index;
+            }
+            const auto shift = static_cast<unsigned>((index - SUB_BUCKETS) / SUB_BUCKETS);
+            const std::uint64_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+            return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+        }
+
+    private:
+        static std::uint64_t Percentile(const std::array<std::uint64_t, BUCKET_COUNT>& counts, std::uint64_t total,
+                                        double quantile, std::uint64_t max) noexcept {
+            const auto rank = std::max<std::uint64_t>(static_cast<std::uint64_t>(quantile * static_cast<double>(total) + 0.5), 1);
+            std::uint64_t seen = 0;
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                seen += counts[i];
+                if (seen >= rank) {
+                    return std::min(UpperBound(i), max);
+                }
+            }
+            return max;
+        }
+
+        std::array<std::atomic<std::uint64_t>, BUCKET_COUNT> buckets_{};
+        std::atomic<std::uint64_t> count_{0};
+        std::atomic<std::uint64_t> sum_{0};
+        std::atomic<std::uint64_t> max_{0};
+    };
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Histogram.hpp"
+#include "../Clock.hpp"
+#include "../Shared.hpp"
+#include "../Machines/Core/InventoryBudget.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Factory::Metrics {
+
+    enum class CommandType : std::uint8_t {
+        Transport,
+        Process,
+        Generate,
+    };
+
+    inline constexpr size_t COMMAND_TYPE_COUNT = 3;
+    inline constexpr size_t STEP_STATUS_COUNT = 4; // SUCCESS, RETRY, BLOCKED, ERROR
+
+    constexpr const char* toString(CommandType type) noexcept {
+        switch (type) {
+            case CommandType::Transport: return "transport";
+            case CommandType::Process: return "process";
+            case CommandType::Generate: return "generate";
+        }
+        return "unknown";
+    }
+
+    constexpr const char* toString(StepStatus status) noexcept {
+        switch (status) {
+            case SUCCESS: return "success";
+            case RETRY: return "retry";
+            case BLOCKED: return "blocked";
+            case ERROR: return "error";
+        }
+        return "unknown";
+    }
+
+    struct MachineMetricsSnapshot {
+        std::string name;
+        size_t queueDepth{0};
+        size_t maxQueueDepth{0};
+        HistogramSnapshot queueWait;                                 // enqueue to start of service
+        std::array<HistogramSnapshot, COMMAND_TYPE_COUNT> service;   // by CommandType
+        std::array<std::array<std::uint64_t, STEP_STATUS_COUNT>, COMMAND_TYPE_COUNT> outcomes{};
+        double utilization{0.0}; // share of worker time spent on commands
+        std::vector<Machinery::Occupancy> occupancy;
+    };
+
+    /**
+     * Counters and latency histograms of one machine, recorded by its worker thread (and
+     * by enqueuing threads for the queue depth). All durations are simulated time.
+     */
+    class MachineMetrics {
+    public:
+        void RecordQueueDepth(size_t depth) noexcept {
+            auto max = maxQueueDepth_.load(std::memory_order_relaxed);
+            while (depth > max && !maxQueueDepth_.compare_exchange_weak(max, depth, std::memory_order_relaxed)) {}
+        }
+
+        void RecordCommand(CommandType type, Clock::Duration wait, Clock::Duration service, StepStatus status) noexcept {
+            const auto index = static_cast<size_t>(type);
+            queueWait_.Record(wait);
+            service_[index].Record(service);
+            outcomes_[index][static_cast<size_t>(status)].Add();
+        }
+
+        void RecordBusy(Clock::Duration duration) noexcept { busy_.Add(Nanoseconds(duration)); }
+
+        void RecordIdle(Clock::Duration duration) noexcept { idle_.Add(Nanoseconds(duration)); }
+
+        // Fills every field except the name, current depth and occupancy, which the machine adds
+        MachineMetricsSnapshot Snapshot() const {
+            MachineMetricsSnapshot snapshot;
+            snapshot.maxQueueDepth = maxQueueDepth_.load(std::memory_order_relaxed);
+            snapshot.queueWait = queueWait_.Snapshot();
+            for (size_t t = 0; t < COMMAND_TYPE_COUNT; ++t) {
+                snapshot.service[t] = service_[t].Snapshot();
+                for (size_t s = 0; s < STEP_STATUS_COUNT; ++s) {
+                    snapshot.outcomes[t][s] = outcomes_[t][s].Value();
+                }
+            }
+            const auto busy = busy_.Value();
+            const auto total = busy + idle_.Value();
+            snapshot.utilization = total == 0 ? 0.0 : static_cast<double>(busy) / static_cast<double>(total);
+            return snapshot;
+        }
+
+    private:
+        static std::uint64_t Nanoseconds(Clock::Duration duration) noexcept {
+            return static_cast<std::uint64_t>(std::max<Clock::Duration::rep>(duration.count(), 0));
+        }
+
+        Histogram queueWait_;
+        std::array<Histogram, COMMAND_TYPE_COUNT> service_;
+        std::array<std::array<Counter, STEP_STATUS_COUNT>, COMMAND_TYPE_COUNT> outcomes_;
+        Counter busy_;
+        Counter idle_;
+        std::atomic<size_t> maxQueueDepth_{0};
+    };
+}
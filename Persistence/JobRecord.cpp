@@ -0,0 +1,75 @@
+#include "JobRecord.hpp"
+
+#include <stdexcept>
+
+namespace Factory::Persistence {
+
+    namespace {
+        Machinery::MachineBase& Machine(const MachineResolver& resolve, Machinery::MachineId id) {
+            auto* machine = resolve(id);
+            if (machine == nullptr) {
+                throw std::invalid_argument("[JOURNAL] no machine with id " + std::to_string(id));
+            }
+            return *machine;
+        }
+    }
+
+    JobRecord recordJob(const Job& job, Clock::TimePoint submittedAt) {
+        JobRecord record;
+        record.name = job.name();
+        record.priority = job.priority();
+        if (job.deadline()) {
+            record.deadlineIn = *job.deadline() - submittedAt;
+        }
+        record.steps.reserve(job.stepCount());
+        for (StepId id = 0; id < job.stepCount(); ++id) {
+            StepRecord step = std::visit([](const auto& s) {
+                using S = std::decay_t<decltype(s)>;
+                StepRecord r;
+                r.material = s.material;
+                if constexpr (std::is_same_v<S, MoveStep>) {
+                    r.move = true;
+                    r.machine = s.source.get().Id();
+                    r.destination = s.destination.get().Id();
+                    if (s.mover) {
+                        r.mover = s.mover->get().Id();
+                    }
+                } else {
+                    r.machine = s.executor.get().Id();
+                    r.product = s.product;
+                    r.maxItems = s.maxItems;
+                }
+                return r;
+            }, job.step(id));
+            step.dependencies.assign(job.dependencies(id).begin(), job.dependencies(id).end());
+            record.steps.push_back(std::move(step));
+        }
+        return record;
+    }
+
+    Job restoreJob(const JobRecord& record, const MachineResolver& resolve, Clock::TimePoint now) {
+        Job job(record.name);
+        job.setPriority(record.priority);
+        if (record.deadlineIn) {
+            job.setDeadline(now + *record.deadlineIn);
+        }
+        for (const auto& s : record.steps) {
+            const std::vector<StepId> dependencies(s.dependencies.begin(), s.dependencies.end());
+            if (!s.move) {
+                job.addStep(ProcessStep{Machine(resolve, s.machine), s.material, s.product,
+                                        static_cast<size_t>(s.maxItems)}, dependencies);
+                continue;
+            }
+            MoveStep move{s.material, Machine(resolve, s.machine), Machine(resolve, s.destination)};
+            if (s.mover != Machinery::UNASSIGNED_MACHINE_ID) {
+                auto* mover = dynamic_cast<Machinery::Mover*>(&Machine(resolve, s.mover));
+                if (mover == nullptr) {
+                    throw std::invalid_argument("[JOURNAL] machine " + std::to_string(s.mover) + " is not a mover");
+                }
+                move.mover = *mover;
+            }
+            job.addStep(std::move(move), dependencies);
+        }
+        return job;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../Job.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Factory::Persistence {
+
+    // One step of a journaled job, with machines named by their ids
+    struct StepRecord {
+        bool move{false};
+        Data::MaterialKind material{Data::MaterialKind::Invalid};
+        Data::MaterialKind product{Data::MaterialKind::Invalid}; // process steps
+        Machinery::MachineId machine{Machinery::UNASSIGNED_MACHINE_ID};     // source of a move, executor of a process
+        Machinery::MachineId destination{Machinery::UNASSIGNED_MACHINE_ID}; // move steps
+        Machinery::MachineId mover{Machinery::UNASSIGNED_MACHINE_ID};       // pinned mover, else the pool
+        std::uint64_t maxItems{1};
+        std::vector<std::uint32_t> dependencies{};
+    };
+
+    /**
+     * A job as it is written to the journal: everything needed to build it again in a later
+     * run of the same factory, where machines are registered in the same order and so get
+     * the same ids.
+     */
+    struct JobRecord {
+        std::string name;
+        JobPriority priority{JobPriority::Normal};
+        std::optional<Clock::Duration> deadlineIn; // deadline relative to submission
+        std::vector<StepRecord> steps;
+    };
+
+    // Looks up a registered machine by id; nullptr if there is none
+    using MachineResolver = std::function<Machinery::MachineBase*(Machinery::MachineId)>;
+
+    /** Describes a job for the journal; `submittedAt` anchors its deadline.
+     * @throws std::bad_alloc
+     */
+    JobRecord recordJob(const Job& job, Clock::TimePoint submittedAt);
+
+    /** Builds a journaled job again; its deadline is set relative to `now`.
+     * @throws std::invalid_argument if a machine id does not resolve, or a pinned mover is not a Mover
+     * @throws std::out_of_range if a step depends on a later step
+     * @throws std::bad_alloc
+     */
+    Job restoreJob(const JobRecord& record, const MachineResolver& resolve, Clock::TimePoint now);
+}
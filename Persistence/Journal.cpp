@@ -0,0 +1,798 @@
+#include "Journal.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Factory::Persistence {
+
+    namespace {
+        constexpr char MAGIC[8] = {'S', 'W', 'P', 'K', 'J', 'R', 'N', 'L'};
+        constexpr std::uint32_t FORMAT_VERSION = 1;
+        constexpr std::uint32_t SEGMENT_FILE = 0;
+        constexpr std::uint32_t SNAPSHOT_FILE = 1;
+
+        // Every file starts with a FileHeader padded to this size; records follow
+        constexpr size_t FILE_HEADER_BYTES = 64;
+        // Record header: payload length (0 ends the records), checksum, type, 3 bytes padding
+        constexpr size_t RECORD_HEADER_BYTES = 12;
+        // Records start at multiples of this, so the length can be published atomically
+        constexpr size_t RECORD_ALIGNMENT = 8;
+
+        constexpr const char* SNAPSHOT_NAME = "snapshot";
+        constexpr const char* SNAPSHOT_TEMP_NAME = "snapshot.tmp";
+        constexpr const char* SEGMENT_PREFIX = "journal-";
+        constexpr const char* SEGMENT_SUFFIX = ".log";
+
+        struct FileHeader {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t type;
+            std::uint64_t number;    // segment number; for the snapshot, the last segment folded into it
+            std::uint64_t nextJobId; // snapshot only
+        };
+        static_assert(sizeof(FileHeader) <= FILE_HEADER_BYTES);
+
+        constexpr size_t RecordBytes(size_t payload) noexcept {
+            return (RECORD_HEADER_BYTES + payload + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+        }
+
+        // FNV-1a over type and payload; tells a record torn by a crash from a whole one
+        std::uint32_t Checksum(std::uint8_t type, const char* payload, size_t size) noexcept {
+            std::uint32_t hash = 2166136261u;
+            hash = (hash ^ type) * 16777619u;
+            for (size_t i = 0; i < size; ++i) {
+                hash = (hash ^ static_cast<std::uint8_t>(payload[i])) * 16777619u;
+            }
+            return hash;
+        }
+
+        [[noreturn]] void ThrowErrno(const std::string& what) {
+            throw std::system_error(errno, std::generic_category(), "[JOURNAL] " + what);
+        }
+
+        std::filesystem::path SegmentPath(const std::filesystem::path& directory, std::uint64_t number) {
+            return directory / (SEGMENT_PREFIX + std::to_string(number) + SEGMENT_SUFFIX);
+        }
+
+        std::optional<std::uint64_t> SegmentNumber(const std::filesystem::path& file) {
+            const std::string name = file.filename().string();
+            const std::string prefix = SEGMENT_PREFIX;
+            const std::string suffix = SEGMENT_SUFFIX;
+            if (name.size() <= prefix.size() + suffix.size() || !name.starts_with(prefix) || !name.ends_with(suffix)) {
+                return std::nullopt;
+            }
+            const std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+            if (!std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+                return std::nullopt;
+            }
+            return std::stoull(digits);
+        }
+
+        FileHeader MakeHeader(std::uint32_t type, std::uint64_t number, std::uint64_t nextJobId) noexcept {
+            FileHeader header{};
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = FORMAT_VERSION;
+            header.type = type;
+            header.number = number;
+            header.nextJobId = nextJobId;
+            return header;
+        }
+
+        bool ValidHeader(const FileHeader& header, std::uint32_t type) noexcept {
+            return std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == FORMAT_VERSION
+                   && header.type == type;
+        }
+
+        void SyncDirectory(const std::filesystem::path& directory) {
+            const int fd = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                ThrowErrno("cannot open " + directory.string());
+            }
+            const int synced = ::fsync(fd);
+            const int error = errno;
+            ::close(fd);
+            if (synced != 0) {
+                errno = error;
+                ThrowErrno("cannot sync " + directory.string());
+            }
+        }
+
+        size_t PageSize() noexcept {
+            static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        // Owns an open file descriptor
+        class FileDescriptor {
+        public:
+            explicit FileDescriptor(int fd = -1) noexcept : fd_(fd) {}
+            ~FileDescriptor() {
+                if (fd_ >= 0) {
+                    ::close(fd_);
+                }
+            }
+            FileDescriptor(FileDescriptor&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+            FileDescriptor& operator=(FileDescriptor&& other) noexcept {
+                std::swap(fd_, other.fd_);
+                return *this;
+            }
+
+            int Get() const noexcept { return fd_; }
+
+        private:
+            int fd_;
+        };
+
+        // Owns a mapping of a whole file
+        class Mapping {
+        public:
+            Mapping() noexcept = default;
+            Mapping(void* base, size_t size) noexcept : base_(base), size_(size) {}
+            ~Mapping() {
+                if (base_ != nullptr) {
+                    ::munmap(base_, size_);
+                }
+            }
+            Mapping(Mapping&& other) noexcept
+                : base_(std::exchange(other.base_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+            Mapping& operator=(Mapping&& other) noexcept {
+                std::swap(base_, other.base_);
+                std::swap(size_, other.size_);
+                return *this;
+            }
+
+            char* Base() const noexcept { return static_cast<char*>(base_); }
+
+        private:
+            void* base_{nullptr};
+            size_t size_{0};
+        };
+
+        // Builds a variable-size payload
+        class Encoder {
+        public:
+            explicit Encoder(std::string& out) noexcept : out_(out) {}
+
+            template<class T>
+            void Put(T value) {
+                static_assert(std::is_trivially_copyable_v<T>);
+                out_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+            }
+
+            void PutString(const std::string& value) {
+                Put(static_cast<std::uint32_t>(value.size()));
+                out_.append(value);
+            }
+
+        private:
+            std::string& out_;
+        };
+
+        // Builds the payload of a fixed-size record without allocating
+        struct SmallPayload {
+            char bytes[16];
+            size_t size{0};
+
+            template<class T>
+            void Put(T value) noexcept {
+                static_assert(std::is_trivially_copyable_v<T>);
+                std::memcpy(bytes + size, &value, sizeof(T));
+                size += sizeof(T);
+            }
+        };
+
+        class Decoder {
+        public:
+            Decoder(const char* data, size_t size) noexcept : data_(data), size_(size) {}
+
+            /** @throws std::runtime_error if the payload ends early */
+            template<class T>
+            T Get() {
+                static_assert(std::is_trivially_copyable_v<T>);
+                Need(sizeof(T));
+                T value;
+                std::memcpy(&value, data_ + at_, sizeof(T));
+                at_ += sizeof(T);
+                return value;
+            }
+
+            std::string GetString() {
+                const auto size = Get<std::uint32_t>();
+                Need(size);
+                std::string value(data_ + at_, size);
+                at_ += size;
+                return value;
+            }
+
+        private:
+            void Need(size_t bytes) const {
+                if (size_ - at_ < bytes) {
+                    throw std::runtime_error("[JOURNAL] record ends early");
+                }
+            }
+
+            const char* data_;
+            size_t size_;
+            size_t at_{0};
+        };
+
+        void EncodeJob(Encoder& out, const JobRecord& job) {
+            out.PutString(job.name);
+            out.Put(static_cast<std::uint8_t>(job.priority));
+            out.Put(static_cast<std::uint8_t>(job.deadlineIn.has_value()));
+            out.Put(static_cast<std::int64_t>(job.deadlineIn.value_or(Clock::Duration::zero()).count()));
+            out.Put(static_cast<std::uint32_t>(job.steps.size()));
+            for (const auto& step : job.steps) {
+                out.Put(static_cast<std::uint8_t>(step.move));
+                out.Put(static_cast<std::uint8_t>(step.material));
+                out.Put(static_cast<std::uint8_t>(step.product));
+                out.Put(step.machine);
+                out.Put(step.destination);
+                out.Put(step.mover);
+                out.Put(step.maxItems);
+                out.Put(static_cast<std::uint32_t>(step.dependencies.size()));
+                for (auto dependency : step.dependencies) {
+                    out.Put(dependency);
+                }
+            }
+        }
+
+        Data::MaterialKind DecodeKind(std::uint8_t value) {
+            if (value > static_cast<std::uint8_t>(Data::MaterialKind::Invalid)) {
+                throw std::runtime_error("[JOURNAL] unknown material kind");
+            }
+            return static_cast<Data::MaterialKind>(value);
+        }
+
+        JobRecord DecodeJob(Decoder& in) {
+            JobRecord job;
+            job.name = in.GetString();
+            const auto priority = in.Get<std::uint8_t>();
+            if (priority >= JOB_PRIORITY_COUNT) {
+                throw std::runtime_error("[JOURNAL] unknown job priority");
+            }
+            job.priority = static_cast<JobPriority>(priority);
+            const bool hasDeadline = in.Get<std::uint8_t>() != 0;
+            const auto deadlineIn = Clock::Duration(in.Get<std::int64_t>());
+            if (hasDeadline) {
+                job.deadlineIn = deadlineIn;
+            }
+            const auto steps = in.Get<std::uint32_t>();
+            for (std::uint32_t i = 0; i < steps; ++i) {
+                StepRecord step;
+                step.move = in.Get<std::uint8_t>() != 0;
+                step.material = DecodeKind(in.Get<std::uint8_t>());
+                step.product = DecodeKind(in.Get<std::uint8_t>());
+                step.machine = in.Get<Machinery::MachineId>();
+                step.destination = in.Get<Machinery::MachineId>();
+                step.mover = in.Get<Machinery::MachineId>();
+                step.maxItems = in.Get<std::uint64_t>();
+                const auto dependencies = in.Get<std::uint32_t>();
+                for (std::uint32_t d = 0; d < dependencies; ++d) {
+                    step.dependencies.push_back(in.Get<std::uint32_t>());
+                }
+                job.steps.push_back(std::move(step));
+            }
+            return job;
+        }
+
+        // Appends a whole record to a snapshot being built
+        void AppendRecord(std::string& out, std::uint8_t type, const char* payload, size_t size) {
+            const auto length = static_cast<std::uint32_t>(size);
+            const auto checksum = Checksum(type, payload, size);
+            const size_t start = out.size();
+            out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            out.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+            out.push_back(static_cast<char>(type));
+            out.append(3, '\0');
+            out.append(payload, size);
+            out.resize(start + RecordBytes(size), '\0');
+        }
+
+        // Writes a record into a mapped segment. The length goes last, so a crash mid-write
+        // leaves a zero length (the end of the records) rather than half a record.
+        void WriteRecord(char* at, std::uint8_t type, const char* payload, std::uint32_t size) noexcept {
+            const auto checksum = Checksum(type, payload, size);
+            std::memcpy(at + sizeof(std::uint32_t), &checksum, sizeof(checksum));
+            at[2 * sizeof(std::uint32_t)] = static_cast<char>(type);
+            std::memcpy(at + RECORD_HEADER_BYTES, payload, size);
+            std::atomic_ref<std::uint32_t>(*reinterpret_cast<std::uint32_t*>(at)).store(size, std::memory_order_release);
+        }
+    }
+
+    // A mapped segment file records are appended to
+    struct Journal::Segment {
+        std::uint64_t number{0};
+        std::filesystem::path path;
+        FileDescriptor file;
+        Mapping mapping;
+        char* base{nullptr};
+        size_t capacity{0};
+        std::atomic<size_t> tail{FILE_HEADER_BYTES}; // next free byte; runs past capacity once full
+        size_t synced{0}; // end of the unbroken prefix of records known to be on disk; guarded by maintenanceMutex_
+    };
+
+    // Unfinished jobs and stock, folded from records in journal order
+    class Journal::State {
+    public:
+        std::uint64_t nextJobId{0};
+        std::uint64_t records{0};
+
+        /** Applies the whole records in [begin, end) of `base` and returns where they stop:
+         * at `end`, at a zero length or at the first torn record.
+         * @throws std::runtime_error if a whole record cannot be decoded
+         */
+        size_t Replay(const char* base, size_t begin, size_t end) {
+            size_t at = begin;
+            while (end - at >= RECORD_HEADER_BYTES) {
+                std::uint32_t length;
+                std::uint32_t checksum;
+                std::memcpy(&length, base + at, sizeof(length));
+                std::memcpy(&checksum, base + at + sizeof(length), sizeof(checksum));
+                const auto type = static_cast<std::uint8_t>(base[at + 2 * sizeof(std::uint32_t)]);
+                const char* payload = base + at + RECORD_HEADER_BYTES;
+                if (length == 0 || length > end - at - RECORD_HEADER_BYTES
+                    || Checksum(type, payload, length) != checksum) {
+                    break;
+                }
+                Apply(static_cast<RecordType>(type), payload, length);
+                ++records;
+                at = std::min(at + RecordBytes(length), end);
+            }
+            return at;
+        }
+
+        // Appends the state as records, the smallest journal that replays to it
+        void Encode(std::string& out) const {
+            for (const auto& [id, job] : jobs_) {
+                std::string payload;
+                Encoder encoder(payload);
+                encoder.Put(id);
+                EncodeJob(encoder, job.job);
+                AppendRecord(out, static_cast<std::uint8_t>(RecordType::JobSubmitted), payload.data(), payload.size());
+                for (StepId step : job.completed) {
+                    SmallPayload completed;
+                    completed.Put(id);
+                    completed.Put(static_cast<std::uint32_t>(step));
+                    AppendRecord(out, static_cast<std::uint8_t>(RecordType::StepCompleted), completed.bytes,
+                                 completed.size);
+                }
+            }
+            for (const auto& [key, count] : stock_) {
+                SmallPayload stock;
+                stock.Put(key.first);
+                stock.Put(static_cast<std::uint8_t>(key.second));
+                stock.Put(static_cast<std::int32_t>(std::clamp<std::int64_t>(
+                    count, std::numeric_limits<std::int32_t>::min(), std::numeric_limits<std::int32_t>::max())));
+                AppendRecord(out, static_cast<std::uint8_t>(RecordType::StockChanged), stock.bytes, stock.size);
+            }
+        }
+
+        // Items reported out of a machine before the journal saw them come in count as none
+        RecoveredState Export() const {
+            RecoveredState state;
+            for (const auto& [id, job] : jobs_) {
+                state.jobs.push_back(job);
+            }
+            for (const auto& [key, count] : stock_) {
+                if (count > 0) {
+                    state.stock.push_back(RecoveredStock{key.first, key.second, static_cast<std::uint64_t>(count)});
+                }
+            }
+            state.records = records;
+            return state;
+        }
+
+    private:
+        void Apply(RecordType type, const char* payload, size_t size) {
+            Decoder in(payload, size);
+            switch (type) {
+                case RecordType::JobSubmitted: {
+                    const auto id = in.Get<std::uint64_t>();
+                    jobs_.insert_or_assign(id, RecoveredJob{id, DecodeJob(in), {}});
+                    nextJobId = std::max(nextJobId, id + 1);
+                    return;
+                }
+                case RecordType::StepCompleted: {
+                    const auto id = in.Get<std::uint64_t>();
+                    const StepId step = in.Get<std::uint32_t>();
+                    const auto it = jobs_.find(id);
+                    if (it != jobs_.end() && step < it->second.job.steps.size()
+                        && std::find(it->second.completed.begin(), it->second.completed.end(), step)
+                           == it->second.completed.end()) {
+                        it->second.completed.push_back(step);
+                    }
+                    return;
+                }
+                case RecordType::JobFinished:
+                    jobs_.erase(in.Get<std::uint64_t>());
+                    return;
+                case RecordType::StockChanged: {
+                    const auto machine = in.Get<Machinery::MachineId>();
+                    const auto kind = DecodeKind(in.Get<std::uint8_t>());
+                    const auto delta = in.Get<std::int32_t>();
+                    const auto key = std::make_pair(machine, kind);
+                    if ((stock_[key] += delta) == 0) {
+                        stock_.erase(key);
+                    }
+                    return;
+                }
+            }
+            throw std::runtime_error("[JOURNAL] unknown record type " + std::to_string(static_cast<int>(type)));
+        }
+
+        std::map<std::uint64_t, RecoveredJob> jobs_; // ids grow with submission
+        std::map<std::pair<Machinery::MachineId, Data::MaterialKind>, std::int64_t> stock_;
+    };
+
+    Journal::Journal(std::filesystem::path directory)
+        : directory_(std::move(directory)), state_(std::make_unique<State>()) {
+        std::filesystem::create_directories(directory_);
+        Recover();
+        flusher_ = std::thread(&Journal::FlusherLoop, this);
+    }
+
+    Journal::~Journal() {
+        {
+            std::lock_guard<std::mutex> lock(flusherMutex_);
+            stopFlusher_ = true;
+        }
+        flusherCV_.notify_all();
+        if (flusher_.joinable()) {
+            flusher_.join();
+        }
+        std::lock_guard<std::mutex> maintenance(maintenanceMutex_);
+        try {
+            SyncActive();
+        } catch (const std::exception& e) {
+            FACTORY_LOG_ERROR("[JOURNAL] final commit failed with error: ", e.what());
+        }
+        // Sealed segments that were not folded yet are replayed at the next start
+        for (const auto& segment : sealed_) {
+            ::msync(segment->base, std::min(segment->tail.load(), segment->capacity), MS_SYNC);
+        }
+    }
+
+    void Journal::JobSubmitted(std::uint64_t job, const JobRecord& record) {
+        std::string payload;
+        Encoder encoder(payload);
+        encoder.Put(job);
+        EncodeJob(encoder, record);
+        if (RecordBytes(payload.size()) > JOURNAL_SEGMENT_BYTES - FILE_HEADER_BYTES) {
+            throw std::length_error("[JOURNAL] job " + record.name + " does not fit in a journal segment");
+        }
+        if (!Append(RecordType::JobSubmitted, payload.data(), payload.size())) {
+            throw std::runtime_error("[JOURNAL] no segment could take job " + record.name);
+        }
+    }
+
+    void Journal::StepCompleted(std::uint64_t job, StepId step) noexcept {
+        SmallPayload payload;
+        payload.Put(job);
+        payload.Put(static_cast<std::uint32_t>(step));
+        if (!Append(RecordType::StepCompleted, payload.bytes, payload.size)) {
+            dropped_.fetch_add(1);
+            FACTORY_LOG_ERROR("[JOURNAL] dropped the completion of step ", step + 1, " of job #", job);
+        }
+    }
+
+    void Journal::JobFinished(std::uint64_t job) noexcept {
+        SmallPayload payload;
+        payload.Put(job);
+        if (!Append(RecordType::JobFinished, payload.bytes, payload.size)) {
+            dropped_.fetch_add(1);
+            FACTORY_LOG_ERROR("[JOURNAL] dropped the end of job #", job);
+        }
+    }
+
+    void Journal::OnStockChanged(Machinery::MachineId machine, Data::MaterialKind kind, int delta) noexcept {
+        SmallPayload payload;
+        payload.Put(machine);
+        payload.Put(static_cast<std::uint8_t>(kind));
+        payload.Put(static_cast<std::int32_t>(delta));
+        if (!Append(RecordType::StockChanged, payload.bytes, payload.size)) {
+            dropped_.fetch_add(1);
+            FACTORY_LOG_ERROR("[JOURNAL] dropped a stock change of machine ", machine);
+        }
+    }
+
+    void Journal::Commit() {
+        std::lock_guard<std::mutex> maintenance(maintenanceMutex_);
+        SyncActive();
+    }
+
+    void Journal::Compact() {
+        std::lock_guard<std::mutex> maintenance(maintenanceMutex_);
+        const Segment* active;
+        {
+            std::shared_lock<std::shared_mutex> lock(segmentMutex_);
+            active = active_.get();
+        }
+        Rotate(active);
+        CompactSealed();
+    }
+
+    bool Journal::Append(RecordType type, const void* payload, size_t size) noexcept {
+        const size_t bytes = RecordBytes(size);
+        if (bytes > JOURNAL_SEGMENT_BYTES - FILE_HEADER_BYTES) {
+            return false;
+        }
+        while (true) {
+            const Segment* full;
+            {
+                std::shared_lock<std::shared_mutex> lock(segmentMutex_);
+                Segment& segment = *active_;
+                const size_t at = segment.tail.fetch_add(bytes, std::memory_order_relaxed);
+                if (at + bytes <= segment.capacity) {
+                    WriteRecord(segment.base + at, static_cast<std::uint8_t>(type), static_cast<const char*>(payload),
+                                static_cast<std::uint32_t>(size));
+                    records_.fetch_add(1, std::memory_order_relaxed);
+                    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+                    return true;
+                }
+                full = &segment;
+            }
+            if (!Rotate(full)) {
+                return false;
+            }
+        }
+    }
+
+    bool Journal::Rotate(const Segment* full) noexcept {
+        try {
+            // Only one thread creates the next file; appenders keep using the current segment meanwhile
+            std::lock_guard<std::mutex> rotating(rotateMutex_);
+            {
+                std::shared_lock<std::shared_mutex> lock(segmentMutex_);
+                if (active_.get() != full) {
+                    return true; // another thread rotated it already
+                }
+            }
+            auto next = OpenSegment(full->number + 1);
+            {
+                std::unique_lock<std::shared_mutex> lock(segmentMutex_);
+                sealed_.push_back(std::move(active_));
+                active_ = std::move(next);
+            }
+        } catch (const std::exception& e) {
+            FACTORY_LOG_ERROR("[JOURNAL] failed to start a new segment with error: ", e.what());
+            return false;
+        }
+        flusherCV_.notify_one();
+        return true;
+    }
+
+    std::unique_ptr<Journal::Segment> Journal::OpenSegment(std::uint64_t number) const {
+        auto segment = std::make_unique<Segment>();
+        segment->number = number;
+        segment->path = SegmentPath(directory_, number);
+        segment->capacity = JOURNAL_SEGMENT_BYTES;
+        segment->file = FileDescriptor(::open(segment->path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        if (segment->file.Get() < 0) {
+            ThrowErrno("cannot create " + segment->path.string());
+        }
+        if (::ftruncate(segment->file.Get(), static_cast<off_t>(segment->capacity)) != 0) {
+            ThrowErrno("cannot size " + segment->path.string());
+        }
+        void* base = ::mmap(nullptr, segment->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, segment->file.Get(), 0);
+        if (base == MAP_FAILED) {
+            ThrowErrno("cannot map " + segment->path.string());
+        }
+        segment->mapping = Mapping(base, segment->capacity);
+        segment->base = static_cast<char*>(base);
+
+        const FileHeader header = MakeHeader(SEGMENT_FILE, number, 0);
+        std::memcpy(segment->base, &header, sizeof(header));
+        // The file itself must survive a machine crash, or the records in it cannot be found
+        if (::fsync(segment->file.Get()) != 0) {
+            ThrowErrno("cannot sync " + segment->path.string());
+        }
+        SyncDirectory(directory_);
+        segment->synced = FILE_HEADER_BYTES;
+        return segment;
+    }
+
+    void Journal::Recover() {
+        const auto started = std::chrono::steady_clock::now();
+        std::uint64_t covered = 0;
+        const auto snapshotPath = directory_ / SNAPSHOT_NAME;
+        if (std::filesystem::exists(snapshotPath)) {
+            std::ifstream in(snapshotPath, std::ios::binary);
+            const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            FileHeader header{};
+            if (data.size() >= FILE_HEADER_BYTES) {
+                std::memcpy(&header, data.data(), sizeof(header));
+            }
+            if (!ValidHeader(header, SNAPSHOT_FILE)
+                || state_->Replay(data.data(), FILE_HEADER_BYTES, data.size()) != data.size()) {
+                throw std::runtime_error("[JOURNAL] snapshot " + snapshotPath.string() + " is corrupt");
+            }
+            covered = header.number;
+            state_->nextJobId = std::max(state_->nextJobId, header.nextJobId);
+        }
+
+        std::vector<std::pair<std::uint64_t, std::filesystem::path>> segments;
+        for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+            if (const auto number = SegmentNumber(entry.path())) {
+                segments.emplace_back(*number, entry.path());
+            }
+        }
+        std::sort(segments.begin(), segments.end());
+
+        std::uint64_t last = covered;
+        for (const auto& [number, path] : segments) {
+            if (number <= covered) {
+                continue; // already in the snapshot; left over from a compaction cut short
+            }
+            last = number;
+            FileDescriptor file(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+            struct stat info{};
+            if (file.Get() < 0 || ::fstat(file.Get(), &info) != 0) {
+                ThrowErrno("cannot open " + path.string());
+            }
+            const auto size = static_cast<size_t>(info.st_size);
+            if (size < FILE_HEADER_BYTES) {
+                continue; // created but never written
+            }
+            void* base = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.Get(), 0);
+            if (base == MAP_FAILED) {
+                ThrowErrno("cannot map " + path.string());
+            }
+            const Mapping mapping(base, size);
+            FileHeader header{};
+            std::memcpy(&header, mapping.Base(), sizeof(header));
+            if (!ValidHeader(header, SEGMENT_FILE) || header.number != number) {
+                FACTORY_LOG_ERROR("[JOURNAL] skipping ", path.string(), ": not a journal segment");
+                continue;
+            }
+            state_->Replay(mapping.Base(), FILE_HEADER_BYTES, size);
+        }
+        nextJobId_.store(state_->nextJobId);
+        recovered_ = state_->Export();
+
+        // Fold what was replayed, so the next start reads the snapshot alone
+        if (last > covered) {
+            WriteSnapshot(last);
+        }
+        for (const auto& [number, path] : segments) {
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+        }
+        active_ = OpenSegment(last + 1);
+        recovered_.replayTime = std::chrono::steady_clock::now() - started;
+        FACTORY_LOG_INFO("[JOURNAL] replayed ", recovered_.records, " records from ", directory_.string(), ": ",
+                         recovered_.jobs.size(), " unfinished jobs, ", recovered_.stock.size(), " stocked kinds");
+    }
+
+    void Journal::SyncActive() {
+        Segment* segment;
+        size_t end;
+        {
+            std::shared_lock<std::shared_mutex> lock(segmentMutex_);
+            segment = active_.get();
+            end = std::min(segment->tail.load(std::memory_order_relaxed), segment->capacity);
+        }
+        // Sealing the segment meanwhile is fine: only this mutex's holder unmaps segments.
+        // The tail counts reserved bytes, some of which other threads may still be writing;
+        // only the unbroken run of published records from `synced` on is synced and counted.
+        // Replay stops at the first unpublished record, so nothing past it would be recovered.
+        size_t published = segment->synced;
+        while (end - published >= RECORD_HEADER_BYTES) {
+            const auto length = std::atomic_ref<std::uint32_t>(*reinterpret_cast<std::uint32_t*>(segment->base + published))
+                                    .load(std::memory_order_acquire);
+            if (length == 0) {
+                break; // reserved but still being written; the next commit picks up from here
+            }
+            published = std::min(published + RecordBytes(length), end);
+        }
+        if (published <= segment->synced) {
+            return;
+        }
+        const size_t from = segment->synced & ~(PageSize() - 1);
+        if (::msync(segment->base + from, published - from, MS_SYNC) != 0) {
+            ThrowErrno("cannot sync " + segment->path.string());
+        }
+        segment->synced = published;
+        commits_.fetch_add(1);
+    }
+
+    void Journal::CompactSealed() {
+        std::vector<std::unique_ptr<Segment>> sealed;
+        {
+            std::unique_lock<std::shared_mutex> lock(segmentMutex_);
+            sealed.swap(sealed_);
+        }
+        if (sealed.empty()) {
+            return;
+        }
+        // On a throw the segment files stay and are replayed at the next start
+        for (const auto& segment : sealed) {
+            state_->Replay(segment->base, FILE_HEADER_BYTES, std::min(segment->tail.load(), segment->capacity));
+        }
+        WriteSnapshot(sealed.back()->number);
+        for (auto& segment : sealed) {
+            const auto path = segment->path;
+            segment.reset();
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+        }
+        compactions_.fetch_add(sealed.size());
+        FACTORY_LOG_DEBUG("[JOURNAL] folded ", sealed.size(), " segment(s) into the snapshot");
+    }
+
+    void Journal::WriteSnapshot(std::uint64_t coveredSegment) const {
+        std::string data(FILE_HEADER_BYTES, '\0');
+        const FileHeader header = MakeHeader(SNAPSHOT_FILE, coveredSegment, nextJobId_.load());
+        std::memcpy(data.data(), &header, sizeof(header));
+        state_->Encode(data);
+
+        // Written aside and renamed over the old one, so a crash leaves one whole snapshot or the other
+        const auto temp = directory_ / SNAPSHOT_TEMP_NAME;
+        {
+            const FileDescriptor file(::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+            if (file.Get() < 0) {
+                ThrowErrno("cannot create " + temp.string());
+            }
+            for (size_t written = 0; written < data.size();) {
+                const ssize_t n = ::write(file.Get(), data.data() + written, data.size() - written);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    ThrowErrno("cannot write " + temp.string());
+                }
+                written += static_cast<size_t>(n);
+            }
+            if (::fsync(file.Get()) != 0) {
+                ThrowErrno("cannot sync " + temp.string());
+            }
+        }
+        std::filesystem::rename(temp, directory_ / SNAPSHOT_NAME);
+        SyncDirectory(directory_);
+    }
+
+    void Journal::FlusherLoop() {
+        std::unique_lock<std::mutex> lock(flusherMutex_);
+        while (!stopFlusher_) {
+            flusherCV_.wait_for(lock, std::chrono::milliseconds(JOURNAL_FLUSH_INTERVAL_MS));
+            if (stopFlusher_) {
+                break; // the destructor commits the rest
+            }
+            lock.unlock();
+            try {
+                std::lock_guard<std::mutex> maintenance(maintenanceMutex_);
+                SyncActive();
+                const Segment* active;
+                size_t tail;
+                {
+                    std::shared_lock<std::shared_mutex> segments(segmentMutex_);
+                    active = active_.get();
+                    tail = active->tail.load(std::memory_order_relaxed);
+                }
+                if (tail > JOURNAL_COMPACT_BYTES) {
+                    Rotate(active);
+                }
+                CompactSealed();
+            } catch (const std::exception& e) {
+                FACTORY_LOG_ERROR("[JOURNAL] group commit failed with error: ", e.what());
+            }
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "JobRecord.hpp"
+#include "../Machines/Core/MachineBase.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+namespace Factory::Persistence {
+
+    // Bytes mapped per journal segment; a segment that fills up is sealed and a new one started
+    inline constexpr size_t JOURNAL_SEGMENT_BYTES = size_t{64} << 20;
+
+    // Size of the active segment past which it is sealed and folded into the snapshot
+    inline constexpr size_t JOURNAL_COMPACT_BYTES = size_t{4} << 20;
+
+    // Group commit interval: records appended meanwhile are synced to disk together (wall-clock milliseconds)
+    inline constexpr int JOURNAL_FLUSH_INTERVAL_MS = 5;
+
+    // A job the journal saw submitted but not finished
+    struct RecoveredJob {
+        std::uint64_t id;
+        JobRecord job;
+        std::vector<StepId> completed; // steps that succeeded before the restart
+    };
+
+    // Items of one kind a machine held
+    struct RecoveredStock {
+        Machinery::MachineId machine;
+        Data::MaterialKind kind;
+        std::uint64_t count;
+    };
+
+    // What an earlier run left in the journal
+    struct RecoveredState {
+        std::vector<RecoveredJob> jobs; // in submission order
+        std::vector<RecoveredStock> stock;
+        std::uint64_t records{0};                    // records replayed, snapshot included
+        std::chrono::nanoseconds replayTime{0};      // wall-clock time spent replaying
+    };
+
+    struct JournalStats {
+        std::uint64_t records;     // appended since the journal was opened
+        std::uint64_t bytes;       // appended since the journal was opened, record headers included
+        std::uint64_t commits;     // group commits that synced new records
+        std::uint64_t compactions; // segments folded into the snapshot
+        std::uint64_t dropped;     // records lost because no segment could take them
+    };
+
+    /**
+     * Append-only, memory-mapped journal of job submissions, step completions and inventory
+     * changes, kept in a directory of its own.
+     *
+     * Appending reserves room in the mapped segment with one atomic add and copies the record
+     * in; no lock is held across I/O and no call waits for the disk. Records are recovered in
+     * order up to the first one that was reserved but not completely written, so a record is
+     * safe from a process crash once it and every record reserved before it have been written:
+     * they sit in the shared page cache. Every JOURNAL_FLUSH_INTERVAL_MS a flusher thread syncs
+     * that written prefix (group commit). A machine crash therefore loses the records of the
+     * last interval, plus any written after a record that was still being written when the
+     * flusher ran.
+     *
+     * Once the active segment passes JOURNAL_COMPACT_BYTES it is sealed and folded into a
+     * snapshot holding only unfinished jobs and current stock. Opening the journal replays
+     * the snapshot plus the few segments written since, so recovery time follows the size of
+     * the live state rather than the length of the history.
+     */
+    class Journal : public Machinery::InventoryObserver {
+    public:
+        /** Opens the journal in `directory`, creating it if need be, and replays what it holds.
+         * @throws std::system_error if a file cannot be created, mapped or synced
+         * @throws std::runtime_error if the snapshot is corrupt
+         * @throws std::bad_alloc
+         */
+        explicit Journal(std::filesystem::path directory);
+
+        // Stops the flusher and syncs every record appended so far
+        ~Journal() override;
+
+        Journal(const Journal&) = delete;
+        Journal& operator=(const Journal&) = delete;
+
+        // State found when the journal was opened
+        const RecoveredState& Recovered() const noexcept { return recovered_; }
+
+        // Id for the next submitted job; unique across restarts
+        std::uint64_t NextJobId() noexcept { return nextJobId_.fetch_add(1); }
+
+        /** Records a submitted job.
+         * @throws std::length_error if the job does not fit in a segment
+         * @throws std::runtime_error if no segment can take the record
+         * @throws std::bad_alloc
+         * Exception guarantee: strong
+         */
+        void JobSubmitted(std::uint64_t job, const JobRecord& record);
+
+        void StepCompleted(std::uint64_t job, StepId step) noexcept;
+
+        // The job finished or failed; either way it is not resumed
+        void JobFinished(std::uint64_t job) noexcept;
+
+        void OnStockChanged(Machinery::MachineId machine, Data::MaterialKind kind, int delta) noexcept override;
+
+        /** Syncs the written prefix of records now, instead of at the next group commit.
+         * Records after one that another thread is still writing wait for a later commit.
+         * @throws std::system_error if syncing fails
+         */
+        void Commit();
+
+        /** Seals the active segment and folds every sealed segment into the snapshot now.
+         * @throws std::system_error on I/O failure
+         * @throws std::bad_alloc
+         */
+        void Compact();
+
+        JournalStats Stats() const noexcept {
+            return JournalStats{records_.load(), bytes_.load(), commits_.load(), compactions_.load(), dropped_.load()};
+        }
+
+    private:
+        enum class RecordType : std::uint8_t {
+            JobSubmitted = 1,
+            StepCompleted,
+            JobFinished,
+            StockChanged,
+        };
+
+        struct Segment;
+        class State;
+
+        // Appends one record; false if no segment can take it
+        bool Append(RecordType type, const void* payload, size_t size) noexcept;
+
+        // Seals `full` and starts the next segment, unless another thread did so already
+        bool Rotate(const Segment* full) noexcept;
+
+        std::unique_ptr<Segment> OpenSegment(std::uint64_t number) const;
+
+        // Replays the snapshot and every segment written after it into state_
+        void Recover();
+
+        // Syncs the active segment up to its first record still being written; caller holds maintenanceMutex_
+        void SyncActive();
+
+        // Folds sealed segments into state_ and rewrites the snapshot; caller holds maintenanceMutex_
+        void CompactSealed();
+
+        void WriteSnapshot(std::uint64_t coveredSegment) const;
+
+        void FlusherLoop();
+
+        std::filesystem::path directory_;
+        std::unique_ptr<State> state_; // snapshot plus sealed segments folded so far; guarded by maintenanceMutex_
+        RecoveredState recovered_;
+        std::atomic<std::uint64_t> nextJobId_{0};
+
+        std::unique_ptr<Segment> active_;
+        std::vector<std::unique_ptr<Segment>> sealed_; // waiting to be folded into the snapshot
+        mutable std::shared_mutex segmentMutex_;       // shared by appenders, exclusive to swap segments
+        std::mutex rotateMutex_;                       // one thread at a time creates the next segment
+        std::mutex maintenanceMutex_;                  // serializes syncing, compaction and unmapping
+
+        std::thread flusher_;
+        std::mutex flusherMutex_;
+        std::condition_variable flusherCV_;
+        bool stopFlusher_{false}; // guarded by flusherMutex_
+
+        std::atomic<std::uint64_t> records_{0};
+        std::atomic<std::uint64_t> bytes_{0};
+        std::atomic<std::uint64_t> commits_{0};
+        std::atomic<std::uint64_t> compactions_{0};
+        std::atomic<std::uint64_t> dropped_{0};
+    };
+}
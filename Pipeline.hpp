@@ -0,0 +1,232 @@
+#pragma once
+
+#include "Job.hpp"
+#include "Machines/MachineTraits.hpp"
+#include "Machines/Core/Dock.hpp"
+#include "Machines/Core/Producer.hpp"
+#include "Machines/Core/ResourceStation.h"
+
+#include <concepts>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Factory {
+
+    namespace Pipelines {
+
+        // What a producer hands out after processing, e.g. MetalPipeHalf for Cutter<MetalPipe>;
+        // void for producers that do not declare an OutputType
+        template<class Machine>
+        struct ProductOf {
+            using type = void;
+        };
+
+        template<class Machine>
+            requires requires { typename Machine::OutputType; }
+        struct ProductOf<Machine> {
+            using type = typename Machine::OutputType;
+        };
+
+        template<class Machine>
+        using product_t = typename ProductOf<Machine>::type;
+
+        // A producer with a typed input, i.e. one that can run a process stage
+        template<class Machine>
+        concept TypedProducer = Machinery::is_producer_v<Machine> && requires { typename Machine::InputType; };
+
+        // A machine that material M can be moved into: a producer taking M as input, or a dock,
+        // which ships whatever arrives
+        template<class Destination, class M>
+        concept Accepts = (TypedProducer<Destination> && std::same_as<typename Destination::InputType, M>)
+                          || std::derived_from<Destination, Machinery::Dock>;
+
+        // A machine that material M can be moved out of: the station for the kinds it generates,
+        // or a producer for its product
+        template<class Source, class M>
+        concept Provides = (Machinery::is_resource_station_v<Source> && Machinery::ResourceStation::Generates(M::kind))
+                           || (TypedProducer<Source> && std::same_as<product_t<Source>, M>);
+
+        // Carries `count` items of M from source to destination, one transport per item, in parallel
+        template<Machinery::HasMaterialKind M, class Source, class Destination>
+        struct MoveStage {
+            using Material = M;
+            Source* source;
+            Destination* destination;
+            size_t count;
+        };
+
+        // One batch cycle of up to `maxItems` items on the machine
+        template<TypedProducer Machine>
+        struct ProcessStage {
+            using Material = typename Machine::InputType;
+            using Product = product_t<Machine>;
+            Machine* machine;
+            size_t maxItems;
+        };
+
+        template<class Stage>
+        inline constexpr bool is_move_stage_v = false;
+
+        template<class M, class Source, class Destination>
+        inline constexpr bool is_move_stage_v<MoveStage<M, Source, Destination>> = true;
+
+        // Commands a stage issues
+        template<class Stage>
+        size_t itemsOf(const Stage& stage) noexcept {
+            if constexpr (is_move_stage_v<Stage>) {
+                return stage.count;
+            } else {
+                return 1;
+            }
+        }
+
+        // Kind of the stage's product, Invalid if the machine does not declare one
+        template<class Stage>
+        constexpr Data::MaterialKind productKindOf() noexcept {
+            if constexpr (std::is_void_v<typename Stage::Product>) {
+                return Data::MaterialKind::Invalid;
+            } else {
+                return Stage::Product::kind;
+            }
+        }
+
+        // Human-readable summary of a stage, e.g. "move 2 MetalPipe Resource_Station -> Cutter-1"
+        template<class Stage>
+        std::string describeStage(const Stage& stage) {
+            if constexpr (is_move_stage_v<Stage>) {
+                return "move " + std::to_string(stage.count) + " " + Data::toString(Stage::Material::kind) + " "
+                       + std::string(stage.source->Name()) + " -> " + std::string(stage.destination->Name());
+            } else {
+                return "process " + std::to_string(stage.maxItems) + " " + Data::toString(Stage::Material::kind)
+                       + " at " + std::string(stage.machine->Name());
+            }
+        }
+
+        // Lowering to the runtime step graph: every step of a stage depends on all steps of the stage before
+        template<class Stage>
+        void addSteps(Job& job, const Stage& stage, std::vector<StepId>& previous) {
+            std::vector<StepId> current;
+            if constexpr (is_move_stage_v<Stage>) {
+                for (size_t i = 0; i < stage.count; ++i) {
+                    current.push_back(job.addStep(
+                        MoveStep{Stage::Material::kind, *stage.source, *stage.destination}, previous));
+                }
+            } else {
+                current.push_back(job.addStep(
+                    ProcessStep{*stage.machine, Stage::Material::kind, productKindOf<Stage>(), stage.maxItems},
+                    previous));
+            }
+            previous = std::move(current);
+        }
+    }
+
+    /**
+     * A fixed recipe as a typed sequence of stages, e.g.
+     *
+     *     const auto cut = Pipeline<>()
+     *         .Move<Data::MetalPipe>(station, cutter, 2)
+     *         .Process(cutter, 2);
+     *
+     * Machine and material types are part of the pipeline's type, so a recipe that moves a
+     * material somewhere it cannot go, processes something that was never delivered, or takes
+     * from a producer something it does not make fails to compile.
+     *
+     * Controller::Launch runs a pipeline as direct calls on its typed machines; ToJob lowers
+     * it to an equivalent Job for the job queue.
+     * A pipeline holds pointers to its machines, which must outlive it.
+     */
+    template<class... Stages>
+    class Pipeline {
+    public:
+        static constexpr size_t STAGE_COUNT = sizeof...(Stages);
+
+        Pipeline() = default;
+
+        explicit Pipeline(std::tuple<Stages...> stages) noexcept : stages_(std::move(stages)) {}
+
+        /** Appends a stage that carries `count` items of M from source to destination in parallel.
+         * @throws std::invalid_argument if count is 0
+         */
+        template<Machinery::HasMaterialKind M, class Source, class Destination>
+        Pipeline<Stages..., Pipelines::MoveStage<M, Source, Destination>> Move(Source& source, Destination& destination,
+                                                                                size_t count = 1) const {
+            static_assert(Pipelines::Provides<Source, M>,
+                          "move source cannot provide this material: the station only hands out what it "
+                          "generates, a producer only its product");
+            static_assert(Pipelines::Accepts<Destination, M>,
+                          "move destination neither takes this material as input nor ships it");
+            if constexpr (Pipelines::TypedProducer<Source>) {
+                static_assert(LastProcessesAt<Source>(),
+                              "moving a product out of a producer requires a process stage at that producer first");
+            }
+            if (count == 0) {
+                throw std::invalid_argument("[PIPELINE] a move stage needs at least one item");
+            }
+            return Pipeline<Stages..., Pipelines::MoveStage<M, Source, Destination>>(std::tuple_cat(
+                stages_, std::make_tuple(Pipelines::MoveStage<M, Source, Destination>{&source, &destination, count})));
+        }
+
+        /** Appends a stage that processes up to `maxItems` of the delivered items in one cycle.
+         * @throws std::invalid_argument if maxItems is 0
+         */
+        template<class Machine>
+        Pipeline<Stages..., Pipelines::ProcessStage<Machine>> Process(Machine& machine, size_t maxItems = 1) const {
+            static_assert(Pipelines::TypedProducer<Machine>, "only a producer with a typed input can process");
+            static_assert(LastDeliversTo<Machine>(),
+                          "a process stage must follow a move of the machine's input type into that machine type");
+            if (maxItems == 0) {
+                throw std::invalid_argument("[PIPELINE] a process stage needs at least one item");
+            }
+            return Pipeline<Stages..., Pipelines::ProcessStage<Machine>>(std::tuple_cat(
+                stages_, std::make_tuple(Pipelines::ProcessStage<Machine>{&machine, maxItems})));
+        }
+
+        const std::tuple<Stages...>& stages() const noexcept { return stages_; }
+
+        /** Lowers the pipeline to a job whose steps run stage after stage.
+         * @throws std::bad_alloc
+         */
+        Job ToJob(std::string name) const {
+            Job job(std::move(name));
+            std::vector<StepId> previous;
+            std::apply([&](const auto&... stage) { (Pipelines::addSteps(job, stage, previous), ...); }, stages_);
+            return job;
+        }
+
+    private:
+        template<class... Other>
+        friend class Pipeline;
+
+        using Last = std::conditional_t<STAGE_COUNT == 0, void,
+                                        std::tuple_element_t<STAGE_COUNT == 0 ? 0 : STAGE_COUNT - 1,
+                                                             std::tuple<Stages..., void>>>;
+
+        template<class Machine>
+        static constexpr bool LastDeliversTo() noexcept {
+            if constexpr (std::is_void_v<Last>) {
+                return false;
+            } else if constexpr (Pipelines::is_move_stage_v<Last>) {
+                return std::is_same_v<decltype(*std::declval<Last>().destination), Machine&>
+                       && std::is_same_v<typename Last::Material, typename Machine::InputType>;
+            } else {
+                return false;
+            }
+        }
+
+        template<class Machine>
+        static constexpr bool LastProcessesAt() noexcept {
+            if constexpr (std::is_void_v<Last>) {
+                return false;
+            } else {
+                return std::is_same_v<Last, Pipelines::ProcessStage<Machine>>;
+            }
+        }
+
+        std::tuple<Stages...> stages_;
+    };
+}
@@ -4,6 +4,7 @@ namespace Factory {
     enum StepStatus{
         SUCCESS,
         RETRY,
+        BLOCKED, // destination has no free capacity; retry once space frees up
         ERROR,
     };
 }
@@ -0,0 +1,73 @@
+#include "TimerQueue.hpp"
+#include "Logging/Logger.hpp"
+
+#include <algorithm>
+
+namespace Factory {
+
+    TimerQueue::TimerQueue(Clock& clock) : clock_(clock) {
+        thread_ = std::thread(&TimerQueue::Loop, this);
+    }
+
+    TimerQueue::~TimerQueue() {
+        Stop();
+    }
+
+    void TimerQueue::ScheduleAfter(Clock::Duration delay, Callback callback) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            timers_.emplace(clock_.Now() + delay, std::move(callback));
+        }
+        cv_.notify_one();
+    }
+
+    void TimerQueue::Stop() noexcept {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stop_.exchange(true)) {
+                return;
+            }
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) {
+            try {
+                thread_.join();
+            } catch (...) {
+                FACTORY_LOG_ERROR("[ERROR] Failed to join timer thread");
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        timers_.clear();
+    }
+
+    void TimerQueue::Loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_.load()) {
+            if (timers_.empty()) {
+                cv_.wait(lock, [this] { return stop_.load() || !timers_.empty(); });
+                continue;
+            }
+
+            auto now = clock_.Now();
+            auto first = timers_.begin();
+            if (first->first <= now) {
+                Callback callback = std::move(first->second);
+                timers_.erase(first);
+                lock.unlock();
+                try {
+                    callback();
+                } catch (std::exception& e) {
+                    FACTORY_LOG_ERROR("[ERROR] Timer callback failed with error: ", e.what());
+                }
+                lock.lock();
+                continue;
+            }
+
+            // Sleep in simulated time, in bounded slices so earlier timers added meanwhile are not missed
+            auto wait = std::min<Clock::Duration>(first->first - now, std::chrono::milliseconds(TIMER_TICK_MS));
+            lock.unlock();
+            clock_.SleepFor(wait);
+            lock.lock();
+        }
+    }
+}
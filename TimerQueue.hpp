@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Clock.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace Factory {
+
+    // Granularity (simulated milliseconds) at which the timer thread re-checks for new, earlier timers
+    inline constexpr int TIMER_TICK_MS = 50;
+
+    /**
+     * Runs callbacks after a delay measured on a simulation Clock.
+     * Callbacks run on the timer thread and must be short; they typically post work
+     * elsewhere.
+     */
+    class TimerQueue {
+    public:
+        using Callback = std::function<void()>;
+
+        explicit TimerQueue(Clock& clock);
+        ~TimerQueue();
+
+        TimerQueue(const TimerQueue&) = delete;
+        TimerQueue& operator=(const TimerQueue&) = delete;
+
+        /** Schedules `callback` to run once `delay` of simulated time has passed.
+         *
+         * @throws std::bad_alloc
+         * Exception guarantee: strong
+         */
+        void ScheduleAfter(Clock::Duration delay, Callback callback);
+
+        /** Stops the timer thread. Pending timers are discarded.
+         *
+         * Exception guarantee: no-throw
+         */
+        void Stop() noexcept;
+
+    private:
+        void Loop();
+
+        Clock& clock_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::multimap<Clock::TimePoint, Callback> timers_;
+        std::atomic_bool stop_{false};
+        std::thread thread_;
+    };
+}
@@ -0,0 +1,167 @@
+#include "Tracer.hpp"
+
+#include <iomanip>
+
+namespace Factory::Tracing {
+
+    namespace {
+        void WriteString(std::ostream& out, std::string_view value) {
+            out << '"';
+            for (char c : value) {
+                switch (c) {
+                    case '"': out << "\\\""; break;
+                    case '\\': out << "\\\\"; break;
+                    case '\n': out << "\\n"; break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20) {
+                            out << ' ';
+                        } else {
+                            out << c;
+                        }
+                }
+            }
+            out << '"';
+        }
+
+        // Chrome traces count in microseconds
+        double Micros(Clock::Duration duration) {
+            return static_cast<double>(duration.count()) / 1000.0;
+        }
+    }
+
+    Tracer& Tracer::Instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    void Tracer::Enable(const Clock& clock) noexcept {
+        clock_.store(&clock, std::memory_order_release);
+        enabled_.store(true, std::memory_order_release);
+    }
+
+    void Tracer::Disable() noexcept {
+        enabled_.store(false, std::memory_order_release);
+    }
+
+    Clock::TimePoint Tracer::Now() const noexcept {
+        const Clock* clock = clock_.load(std::memory_order_acquire);
+        return clock != nullptr ? clock->Now() : Clock::TimePoint{};
+    }
+
+    void Tracer::SetThreadName(std::string name) {
+        if (auto* buffer = LocalBuffer()) {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            buffer->threadName = std::move(name);
+        }
+    }
+
+    void Tracer::Complete(const char* category, std::string name, Clock::TimePoint start, Clock::TimePoint end,
+                          Args args) {
+        Record({'X', category, std::move(name), {}, start, end - start, std::move(args)});
+    }
+
+    void Tracer::AsyncBegin(const char* category, std::string name, std::string id, Args args) {
+        AsyncBegin(category, std::move(name), std::move(id), Now(), std::move(args));
+    }
+
+    void Tracer::AsyncBegin(const char* category, std::string name, std::string id, Clock::TimePoint ts, Args args) {
+        Record({'b', category, std::move(name), std::move(id), ts, {}, std::move(args)});
+    }
+
+    void Tracer::AsyncEnd(const char* category, std::string name, std::string id, Args args) {
+        AsyncEnd(category, std::move(name), std::move(id), Now(), std::move(args));
+    }
+
+    void Tracer::AsyncEnd(const char* category, std::string name, std::string id, Clock::TimePoint ts, Args args) {
+        Record({'e', category, std::move(name), std::move(id), ts, {}, std::move(args)});
+    }
+
+    void Tracer::Instant(const char* category, std::string name, Args args) {
+        Record({'i', category, std::move(name), {}, Now(), {}, std::move(args)});
+    }
+
+    detail::ThreadBuffer* Tracer::LocalBuffer() noexcept {
+        thread_local std::shared_ptr<detail::ThreadBuffer> local;
+        if (!local) {
+            try {
+                auto buffer = std::make_shared<detail::ThreadBuffer>();
+                std::lock_guard<std::mutex> lock(registryMutex_);
+                buffers_.push_back(buffer);
+                local = std::move(buffer);
+            } catch (...) {
+                return nullptr; // out of memory: this thread records nothing
+            }
+        }
+        return local.get();
+    }
+
+    void Tracer::Record(detail::Event event) noexcept {
+        auto* buffer = LocalBuffer();
+        if (buffer == nullptr) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        if (buffer->events.size() >= MAX_EVENTS_PER_THREAD) {
+            ++buffer->dropped;
+            return;
+        }
+        try {
+            buffer->events.push_back(std::move(event));
+        } catch (...) {
+            ++buffer->dropped;
+        }
+    }
+
+    size_t Tracer::WriteChromeTrace(std::ostream& out) const {
+        std::lock_guard<std::mutex> registryLock(registryMutex_);
+        size_t written = 0;
+        size_t dropped = 0;
+        bool first = true;
+        auto separator = [&] {
+            out << (first ? "\n" : ",\n");
+            first = false;
+        };
+
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        for (size_t tid = 0; tid < buffers_.size(); ++tid) {
+            auto& buffer = *buffers_[tid];
+            std::lock_guard<std::mutex> lock(buffer.mutex);
+            dropped += buffer.dropped;
+            if (!buffer.threadName.empty()) {
+                separator();
+                out << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": " << tid
+                    << ", \"args\": {\"name\": ";
+                WriteString(out, buffer.threadName);
+                out << "}}";
+            }
+            for (const auto& event : buffer.events) {
+                separator();
+                out << "{\"ph\": \"" << event.phase << "\", \"cat\": ";
+                WriteString(out, event.category);
+                out << ", \"name\": ";
+                WriteString(out, event.name);
+                out << ", \"pid\": 1, \"tid\": " << tid << ", \"ts\": " << Micros(event.ts.time_since_epoch());
+                if (event.phase == 'X') {
+                    out << ", \"dur\": " << Micros(event.duration);
+                } else if (event.phase == 'i') {
+                    out << ", \"s\": \"t\"";
+                } else {
+                    out << ", \"id\": ";
+                    WriteString(out, event.id);
+                }
+                out << ", \"args\": {";
+                for (size_t i = 0; i < event.args.size(); ++i) {
+                    out << (i == 0 ? "" : ", ");
+                    WriteString(out, event.args[i].key);
+                    out << ": ";
+                    WriteString(out, event.args[i].value);
+                }
+                out << "}}";
+                ++written;
+            }
+        }
+        out << "\n], \"otherData\": {\"droppedEvents\": " << dropped << "}}\n";
+        return written;
+    }
+}
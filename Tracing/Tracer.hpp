@@ -0,0 +1,118 @@
+#pragma once
+
+#include "../Clock.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Factory::Tracing {
+
+    // Events kept per thread; later events are counted as dropped
+    inline constexpr size_t MAX_EVENTS_PER_THREAD = 1u << 20;
+
+    struct Arg {
+        const char* key;
+        std::string value;
+    };
+
+    using Args = std::vector<Arg>;
+
+    namespace detail {
+        struct Event {
+            char phase;             // Chrome trace phase: X complete, b/e async, i instant
+            const char* category;   // static string
+            std::string name;
+            std::string id;         // async events only
+            Clock::TimePoint ts;
+            Clock::Duration duration{}; // complete events only
+            Args args;
+        };
+
+        // Written only by its owning thread; read once recording has been switched off
+        struct ThreadBuffer {
+            std::mutex mutex; // uncontended while recording
+            std::vector<Event> events;
+            std::string threadName;
+            size_t dropped{0};
+        };
+    }
+
+    /**
+     * Optional timeline recorder.
+     * While enabled, jobs, job steps and machine commands record events into buffers owned
+     * by the recording thread; WriteChromeTrace writes them as Chrome trace JSON, which
+     * Perfetto (ui.perfetto.dev) and chrome://tracing open directly. Timestamps are simulated
+     * time of the clock passed to Enable.
+     *
+     * Disabled, every FACTORY_TRACE call is a single relaxed load, and its arguments are not
+     * evaluated.
+     */
+    class Tracer {
+    public:
+        static Tracer& Instance();
+
+        Tracer(const Tracer&) = delete;
+        Tracer& operator=(const Tracer&) = delete;
+
+        /** Starts recording with timestamps from `clock`, which must outlive recording. */
+        void Enable(const Clock& clock) noexcept;
+
+        /** Stops recording. Events recorded so far are kept for WriteChromeTrace. */
+        void Disable() noexcept;
+
+        bool Enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+        // Current time on the tracing clock
+        Clock::TimePoint Now() const noexcept;
+
+        // Names the calling thread's track (machine name, worker index)
+        void SetThreadName(std::string name);
+
+        // A span on the calling thread's track
+        void Complete(const char* category, std::string name, Clock::TimePoint start, Clock::TimePoint end,
+                      Args args = {});
+
+        // Begin and end of a span that may start and finish on different threads, matched by `id`
+        void AsyncBegin(const char* category, std::string name, std::string id, Args args = {});
+        void AsyncBegin(const char* category, std::string name, std::string id, Clock::TimePoint ts, Args args);
+        void AsyncEnd(const char* category, std::string name, std::string id, Args args = {});
+        void AsyncEnd(const char* category, std::string name, std::string id, Clock::TimePoint ts, Args args);
+
+        void Instant(const char* category, std::string name, Args args = {});
+
+        /** Writes every recorded event as a Chrome trace JSON document. Call after Disable,
+         * once the recording threads are quiet.
+         *
+         * @throws std::ios_base::failure if the stream fails
+         * @return number of events written
+         */
+        size_t WriteChromeTrace(std::ostream& out) const;
+
+    private:
+        Tracer() = default;
+
+        detail::ThreadBuffer* LocalBuffer() noexcept;
+        void Record(detail::Event event) noexcept;
+
+        std::atomic_bool enabled_{false};
+        std::atomic<const Clock*> clock_{nullptr};
+        mutable std::mutex registryMutex_;
+        std::vector<std::shared_ptr<detail::ThreadBuffer>> buffers_;
+    };
+}
+
+// Records a trace event when tracing is enabled; the arguments are only evaluated then
+#define FACTORY_TRACE(method, ...)                                                     \
+    do {                                                                               \
+        auto& factoryTracer_ = ::Factory::Tracing::Tracer::Instance();                 \
+        if (factoryTracer_.Enabled()) {                                                \
+            factoryTracer_.method(__VA_ARGS__);                                        \
+        }                                                                              \
+    } while (0)
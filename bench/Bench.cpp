@@ -0,0 +1,77 @@
+#include "Bench.hpp"
+
+#include <atomic>
+#include <iomanip>
+#include <thread>
+
+namespace Factory::Bench {
+
+    double RunConcurrently(size_t threads, const std::function<void(size_t)>& body) {
+        std::atomic<size_t> ready{0};
+        std::atomic_bool go{false};
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([&, i] {
+                ready.fetch_add(1);
+                go.wait(false);
+                body(i);
+            });
+        }
+        while (ready.load() < threads) {
+            std::this_thread::yield();
+        }
+        const auto start = std::chrono::steady_clock::now();
+        go.store(true);
+        go.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    namespace {
+        void WriteString(std::ostream& out, const std::string& value) {
+            out << '"';
+            for (char c : value) {
+                if (c == '"' || c == '\\') {
+                    out << '\\';
+                }
+                out << c;
+            }
+            out << '"';
+        }
+
+        void WriteLatency(std::ostream& out, const Metrics::HistogramSnapshot& latency) {
+            out << "{\"count\": " << latency.count << ", \"mean\": " << latency.mean << ", \"p50\": " << latency.p50
+                << ", \"p90\": " << latency.p90 << ", \"p99\": " << latency.p99 << ", \"p999\": " << latency.p999
+                << ", \"max\": " << latency.max << "}";
+        }
+    }
+
+    void WriteJson(std::ostream& out, const std::string& suite, const std::vector<Result>& results) {
+        out << std::fixed << std::setprecision(3);
+        out << "{\n  \"suite\": ";
+        WriteString(out, suite);
+        out << ",\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto& result = results[i];
+            out << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+            WriteString(out, result.name);
+            out << ", \"params\": {";
+            for (size_t p = 0; p < result.params.size(); ++p) {
+                out << (p == 0 ? "" : ", ");
+                WriteString(out, result.params[p].first);
+                out << ": " << result.params[p].second;
+            }
+            out << "}, \"operations\": " << result.operations << ", \"seconds\": " << result.seconds
+                << ", \"ops_per_sec\": " << result.OpsPerSecond() << ", \"ns_per_op\": " << result.NanosPerOp();
+            if (result.latency) {
+                out << ", \"latency_ns\": ";
+                WriteLatency(out, *result.latency);
+            }
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+}
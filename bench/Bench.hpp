@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../Metrics/Histogram.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Factory::Bench {
+
+    // Outcome of one benchmark run; `operations` completed in `seconds` of wall-clock time
+    struct Result {
+        std::string name;
+        std::vector<std::pair<std::string, std::int64_t>> params;
+        std::uint64_t operations{0};
+        double seconds{0.0};
+        std::optional<Metrics::HistogramSnapshot> latency{}; // per-operation latency in nanoseconds
+
+        double OpsPerSecond() const noexcept { return seconds > 0.0 ? static_cast<double>(operations) / seconds : 0.0; }
+
+        double NanosPerOp() const noexcept {
+            return operations > 0 ? seconds * 1e9 / static_cast<double>(operations) : 0.0;
+        }
+    };
+
+    // Wall-clock seconds taken by `body`
+    inline double TimeSeconds(const std::function<void()>& body) {
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /** Runs `body` on `threads` threads released together and returns the wall-clock
+     * seconds until the last one finished. `body` receives the thread index.
+     *
+     * @throws std::system_error if a thread cannot be started
+     */
+    double RunConcurrently(size_t threads, const std::function<void(size_t)>& body);
+
+    /** Writes all results as one JSON document:
+     * {"suite": ..., "benchmarks": [{"name", "params", "operations", "seconds", "ops_per_sec",
+     * "ns_per_op", "latency_ns"?}]}
+     */
+    void WriteJson(std::ostream& out, const std::string& suite, const std::vector<Result>& results);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../Clock.hpp"
+
+#include <atomic>
+
+namespace Factory::Bench {
+
+    /**
+     * Clock whose sleeps return immediately.
+     * Simulated time only moves when someone sleeps, by the amount slept, so timers and
+     * cost models still see consistent durations while the benchmarks measure nothing but
+     * the code between the sleeps. Wall-clock measurements use std::chrono directly.
+     */
+    class NullClock : public Clock {
+    public:
+        TimePoint Now() const noexcept override {
+            return TimePoint(Duration(now_.load(std::memory_order_relaxed)));
+        }
+
+        void SleepFor(Duration duration) override {
+            if (duration > Duration::zero()) {
+                now_.fetch_add(duration.count(), std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        std::atomic<Duration::rep> now_{0};
+    };
+}
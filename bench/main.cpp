@@ -0,0 +1,438 @@
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "NullClock.hpp"
+#include "../Controller.hpp"
+#include "../Machines/Cutter.hpp"
+#include "../Persistence/Journal.hpp"
+
+// Microbenchmarks for the hot paths of the factory. Every simulated delay runs on a
+// NullClock, so only the code around the sleeps is measured.
+//   swapk_bench               JSON to stdout
+//   swapk_bench <file.json>   JSON to <file.json>
+
+using namespace Factory;
+using Bench::Result;
+
+namespace {
+
+    constexpr std::uint64_t ENQUEUE_COMMANDS = 400'000;
+    constexpr std::uint64_t DISPATCH_CALLS = 2'000'000;
+    constexpr std::uint64_t STATION_ITEMS = 50'000;
+    constexpr std::uint64_t BUFFER_ALLOCATIONS = 2'000'000;
+    constexpr std::uint64_t ROUND_TRIPS = 5'000;
+    constexpr std::uint64_t ARENA_MATERIALS = 1'000'000;
+    constexpr std::uint64_t JOURNAL_EVENTS = 1'000'000;
+
+    // Machine whose commands do nothing and which drops whatever it receives, so enqueueing,
+    // transport and completion are all that is measured
+    class SinkMachine : public Machinery::MachineBase {
+    public:
+        using MachineBase::MachineBase;
+
+        void TryReceive(Data::MaterialHandle&&) override {}
+
+        bool CanAccept(Data::MaterialKind) const noexcept override { return true; }
+
+    protected:
+        StepStatus OnGenerate(const Machinery::GenerateResourceCommand&) override { return SUCCESS; }
+    };
+
+    void WaitFor(const std::atomic<std::uint64_t>& counter, std::uint64_t target) {
+        for (auto seen = counter.load(); seen < target; seen = counter.load()) {
+            counter.wait(seen);
+        }
+    }
+
+    // MachineBase::EnqueueCommand throughput with `producers` threads feeding one machine,
+    // measured until the machine has completed every command
+    Result EnqueueThroughput(size_t producers) {
+        Bench::NullClock clock;
+        SinkMachine machine("Sink");
+        machine.SetClock(clock);
+        machine.StartThread();
+
+        std::atomic<std::uint64_t> completed{0};
+        const std::uint64_t perProducer = ENQUEUE_COMMANDS / producers;
+        const std::uint64_t total = perProducer * producers;
+        const double seconds = Bench::TimeSeconds([&] {
+            Bench::RunConcurrently(producers, [&](size_t) {
+                for (std::uint64_t i = 0; i < perProducer; ++i) {
+                    machine.EnqueueCommand(Machinery::GenerateResourceCommand{
+                        Data::MaterialKind::MetalPipe, [&completed, total](StepStatus) {
+                            if (completed.fetch_add(1) + 1 == total) {
+                                completed.notify_all();
+                            }
+                        }});
+                }
+            });
+            WaitFor(completed, total);
+        });
+        machine.StopThread();
+        return {"enqueue_command", {{"producers", static_cast<std::int64_t>(producers)}}, total, seconds};
+    }
+
+    // Cost executeJobStep pays per move step for the observer signal: the flag check when
+    // observers are disabled, or a signals2 emission with `slots` connected observers
+    Result StepObserverDispatch(Controller& controller, bool enabled, int slots) {
+        Machinery::Mover mover("Bench-Mover");
+        Machinery::ResourceStation station("Bench-Station");
+        SinkMachine sink("Bench-Sink");
+
+        std::atomic_bool observersEnabled{enabled};
+        std::vector<boost::signals2::scoped_connection> connections;
+        std::uint64_t observed = 0;
+        for (int i = 0; i < slots; ++i) {
+            connections.emplace_back(controller.onTransportDispatched.connect(
+                [&observed](const Machinery::Mover&, Data::MaterialKind, const Machinery::MachineBase&,
+                            const Machinery::MachineBase&) { ++observed; }));
+        }
+
+        const double seconds = Bench::TimeSeconds([&] {
+            for (std::uint64_t i = 0; i < DISPATCH_CALLS; ++i) {
+                if (observersEnabled.load(std::memory_order_relaxed)) {
+                    controller.onTransportDispatched(mover, Data::MaterialKind::MetalPipe, station, sink);
+                }
+            }
+        });
+        if (enabled && observed != DISPATCH_CALLS * static_cast<std::uint64_t>(slots)) {
+            std::cerr << "step_observer_dispatch: missed notifications\n";
+        }
+        return {"step_observer_dispatch", {{"enabled", enabled}, {"slots", slots}}, DISPATCH_CALLS, seconds};
+    }
+
+    // ResourceStation::TakeMaterial with `threads` threads draining `kinds` pre-stocked kinds;
+    // thread i takes raw kind i % kinds, so with several kinds the threads share fewer locks
+    Result StationTake(size_t threads, size_t kinds) {
+        Bench::NullClock clock;
+        Machinery::ResourceStation station("Bench-Station");
+        station.SetClock(clock);
+        station.StartThread();
+
+        std::atomic<std::uint64_t> stocked{0};
+        const std::uint64_t total = STATION_ITEMS * kinds;
+        for (size_t k = 0; k < kinds; ++k) {
+            for (std::uint64_t i = 0; i < STATION_ITEMS; ++i) {
+                station.EnqueueCommand(Machinery::GenerateResourceCommand{RAW_MATERIAL_KINDS[k], [&stocked, total](StepStatus) {
+                    if (stocked.fetch_add(1) + 1 == total) {
+                        stocked.notify_all();
+                    }
+                }});
+            }
+        }
+        WaitFor(stocked, total);
+
+        std::atomic<std::uint64_t> taken{0};
+        const double seconds = Bench::RunConcurrently(threads, [&](size_t index) {
+            const auto kind = RAW_MATERIAL_KINDS[index % kinds];
+            std::uint64_t local = 0;
+            while (station.TakeMaterial(kind)) {
+                ++local;
+            }
+            taken.fetch_add(local);
+        });
+        station.StopThread();
+        return {"station_take_material",
+                {{"threads", static_cast<std::int64_t>(threads)}, {"kinds", static_cast<std::int64_t>(kinds)}},
+                taken.load(), seconds};
+    }
+
+    // Mover draining a stocked station into a sink, `capacity` materials per trip; every
+    // transport is queued up front, so trips are always full
+    Result MoverTrips(size_t capacity) {
+        Bench::NullClock clock;
+        Machinery::ResourceStation station("Bench-Station");
+        Machinery::Mover mover("Bench-Mover");
+        SinkMachine sink("Bench-Sink");
+        station.SetClock(clock);
+        mover.SetClock(clock);
+        sink.SetClock(clock);
+        mover.SetCapacity(capacity);
+        station.StartThread();
+
+        std::atomic<std::uint64_t> stocked{0};
+        for (std::uint64_t i = 0; i < STATION_ITEMS; ++i) {
+            station.EnqueueCommand(Machinery::GenerateResourceCommand{Data::MaterialKind::MetalPipe, [&stocked](StepStatus) {
+                if (stocked.fetch_add(1) + 1 == STATION_ITEMS) {
+                    stocked.notify_all();
+                }
+            }});
+        }
+        WaitFor(stocked, STATION_ITEMS);
+
+        std::atomic<std::uint64_t> moved{0};
+        std::vector<Machinery::TransportCommand> loads;
+        loads.reserve(STATION_ITEMS);
+        for (std::uint64_t i = 0; i < STATION_ITEMS; ++i) {
+            loads.push_back(Machinery::TransportCommand{Data::MaterialKind::MetalPipe, station, sink, [&moved](StepStatus) {
+                if (moved.fetch_add(1) + 1 == STATION_ITEMS) {
+                    moved.notify_all();
+                }
+            }});
+        }
+        const double seconds = Bench::TimeSeconds([&] {
+            mover.EnqueueTrip(std::move(loads));
+            mover.StartThread();
+            WaitFor(moved, STATION_ITEMS);
+        });
+        mover.StopThread();
+        station.StopThread();
+        if (mover.GetTripStats().loads != STATION_ITEMS) {
+            std::cerr << "mover_trips: " << STATION_ITEMS - mover.GetTripStats().loads << " materials not moved\n";
+        }
+        return {"mover_trips", {{"capacity", static_cast<std::int64_t>(capacity)}}, STATION_ITEMS, seconds};
+    }
+
+    // DataBuffer allocate/free pairs of `size` bytes on `threads` threads
+    Result BufferAllocation(size_t size, size_t threads) {
+        const std::uint64_t perThread = BUFFER_ALLOCATIONS / threads;
+        const double seconds = Bench::RunConcurrently(threads, [&](size_t) {
+            for (std::uint64_t i = 0; i < perThread; ++i) {
+                Data::DataBuffer buffer(size);
+                std::atomic_signal_fence(std::memory_order_seq_cst); // keep the pair from being elided
+            }
+        });
+        return {"data_buffer_allocation",
+                {{"size", static_cast<std::int64_t>(size)}, {"threads", static_cast<std::int64_t>(threads)}},
+                perThread * threads, seconds};
+    }
+
+    // MaterialArena create/release pairs of 1 KiB pipes on `threads` threads; every item is
+    // handed over `hops` times first, as a transport chain would
+    Result ArenaHandoff(size_t hops, size_t threads) {
+        const std::uint64_t perThread = ARENA_MATERIALS / threads;
+        const double seconds = Bench::RunConcurrently(threads, [&](size_t) {
+            auto& arena = Data::MaterialArena::Instance();
+            for (std::uint64_t i = 0; i < perThread; ++i) {
+                auto material = arena.Create(Data::MetalPipe{Data::DataBuffer(1024)});
+                for (size_t h = 0; h < hops; ++h) {
+                    Data::MaterialHandle next = std::move(material);
+                    material = std::move(next);
+                }
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+            }
+        });
+        return {"material_arena",
+                {{"hops", static_cast<std::int64_t>(hops)}, {"threads", static_cast<std::int64_t>(threads)}},
+                perThread * threads, seconds};
+    }
+
+    // Fresh, empty journal directory under the system temp directory
+    std::filesystem::path JournalDirectory() {
+        auto directory = std::filesystem::temp_directory_path() / "swapk_bench_journal";
+        std::filesystem::remove_all(directory);
+        return directory;
+    }
+
+    // Journal appends of stock changes on `threads` threads, group commits running alongside
+    Result JournalAppend(size_t threads) {
+        const auto directory = JournalDirectory();
+        const std::uint64_t perThread = JOURNAL_EVENTS / threads;
+        double seconds;
+        {
+            Persistence::Journal journal(directory);
+            seconds = Bench::RunConcurrently(threads, [&](size_t index) {
+                const auto machine = static_cast<Machinery::MachineId>(index);
+                for (std::uint64_t i = 0; i < perThread; ++i) {
+                    journal.OnStockChanged(machine, Data::MaterialKind::MetalPipe, i % 2 == 0 ? 1 : -1);
+                }
+            });
+        }
+        std::filesystem::remove_all(directory);
+        return {"journal_append", {{"threads", static_cast<std::int64_t>(threads)}}, perThread * threads, seconds};
+    }
+
+    // Reopening a journal that saw JOURNAL_EVENTS events: three-step jobs submitted, stepped
+    // through and finished, with the stock changes of every step; the last jobs stay unfinished
+    Result JournalRecovery() {
+        constexpr std::uint64_t EVENTS_PER_JOB = 11;
+        constexpr std::uint64_t UNFINISHED_JOBS = 16;
+        const auto directory = JournalDirectory();
+        Persistence::JobRecord record{"bench-job", JobPriority::Normal, std::nullopt, {}};
+        record.steps.push_back({true, Data::MaterialKind::MetalPipe, Data::MaterialKind::Invalid, 0, 1});
+        record.steps.push_back({false, Data::MaterialKind::MetalPipe, Data::MaterialKind::MetalPipeHalf, 1});
+        record.steps.back().dependencies = {0};
+        record.steps.push_back({true, Data::MaterialKind::MetalPipeHalf, Data::MaterialKind::Invalid, 1, 2});
+        record.steps.back().dependencies = {1};
+        const std::uint64_t jobs = JOURNAL_EVENTS / EVENTS_PER_JOB;
+        {
+            Persistence::Journal journal(directory);
+            for (std::uint64_t j = 0; j < jobs; ++j) {
+                const auto id = journal.NextJobId();
+                journal.JobSubmitted(id, record);
+                journal.OnStockChanged(0, Data::MaterialKind::MetalPipe, +1);
+                journal.OnStockChanged(0, Data::MaterialKind::MetalPipe, -1);
+                journal.OnStockChanged(1, Data::MaterialKind::MetalPipe, +1);
+                journal.StepCompleted(id, 0);
+                journal.OnStockChanged(1, Data::MaterialKind::MetalPipe, -1);
+                journal.OnStockChanged(1, Data::MaterialKind::MetalPipeHalf, +1);
+                journal.StepCompleted(id, 1);
+                journal.OnStockChanged(1, Data::MaterialKind::MetalPipeHalf, -1);
+                if (j + UNFINISHED_JOBS < jobs) {
+                    journal.StepCompleted(id, 2);
+                    journal.JobFinished(id);
+                }
+            }
+        }
+        size_t resumed = 0;
+        const double seconds = Bench::TimeSeconds([&] {
+            Persistence::Journal journal(directory);
+            resumed = journal.Recovered().jobs.size();
+        });
+        std::filesystem::remove_all(directory);
+        if (resumed != UNFINISHED_JOBS) {
+            std::cerr << "journal_recovery: recovered " << resumed << " of " << UNFINISHED_JOBS << " unfinished jobs\n";
+        }
+        return {"journal_recovery", {{"events", static_cast<std::int64_t>(jobs * EVENTS_PER_JOB)}},
+                jobs * EVENTS_PER_JOB, seconds};
+    }
+
+    JobCoroutine roundTrip(Machinery::ResourceStation& station, Machinery::Cutter<Data::MetalPipe>& cutter,
+                           std::atomic<std::uint64_t>& finished, std::atomic<std::uint64_t>& failed) {
+        const bool ok = co_await Move(Data::MaterialKind::MetalPipe, station, cutter) == SUCCESS
+                        && co_await Process(cutter, Data::MaterialKind::MetalPipe) == SUCCESS;
+        if (!ok) {
+            failed.fetch_add(1);
+        }
+        finished.fetch_add(1);
+        finished.notify_all();
+    }
+
+    // One job at a time through a full controller: spawn, move from the station, cut, finish
+    Result JobRoundTrip() {
+        Controller controller(std::make_shared<Bench::NullClock>());
+        auto& station = controller.AddMachine<Machinery::ResourceStation>("Bench-Station");
+        controller.AddMachine<Machinery::Mover>("Bench-Arm");
+        auto& cutter = controller.AddMachine<Machinery::Cutter<Data::MetalPipe>>("Bench-Cutter");
+
+        std::atomic<std::uint64_t> stocked{0};
+        for (std::uint64_t i = 0; i < ROUND_TRIPS; ++i) {
+            station.EnqueueCommand(Machinery::GenerateResourceCommand{Data::MaterialKind::MetalPipe, [&stocked](StepStatus) {
+                if (stocked.fetch_add(1) + 1 == ROUND_TRIPS) {
+                    stocked.notify_all();
+                }
+            }});
+        }
+        WaitFor(stocked, ROUND_TRIPS);
+        controller.StartWorkers(2);
+
+        Metrics::Histogram latency;
+        std::atomic<std::uint64_t> finished{0};
+        std::atomic<std::uint64_t> failed{0};
+        const double seconds = Bench::TimeSeconds([&] {
+            for (std::uint64_t i = 0; i < ROUND_TRIPS; ++i) {
+                const auto start = std::chrono::steady_clock::now();
+                controller.Spawn("bench-" + std::to_string(i), roundTrip(station, cutter, finished, failed));
+                WaitFor(finished, i + 1);
+                latency.Record(std::chrono::duration_cast<Clock::Duration>(std::chrono::steady_clock::now() - start));
+            }
+        });
+        if (failed.load() != 0) {
+            std::cerr << "job_round_trip: " << failed.load() << " jobs failed\n";
+        }
+        Result result{"job_round_trip", {{"workers", 2}}, ROUND_TRIPS, seconds};
+        result.latency = latency.Snapshot();
+        return result;
+    }
+
+    // Same round trip as a typed pipeline launched straight onto its machines
+    Result PipelineRoundTrip() {
+        Controller controller(std::make_shared<Bench::NullClock>());
+        auto& station = controller.AddMachine<Machinery::ResourceStation>("Bench-Station");
+        controller.AddMachine<Machinery::Mover>("Bench-Arm");
+        auto& cutter = controller.AddMachine<Machinery::Cutter<Data::MetalPipe>>("Bench-Cutter");
+
+        std::atomic<std::uint64_t> stocked{0};
+        for (std::uint64_t i = 0; i < ROUND_TRIPS; ++i) {
+            station.EnqueueCommand(Machinery::GenerateResourceCommand{Data::MaterialKind::MetalPipe, [&stocked](StepStatus) {
+                if (stocked.fetch_add(1) + 1 == ROUND_TRIPS) {
+                    stocked.notify_all();
+                }
+            }});
+        }
+        WaitFor(stocked, ROUND_TRIPS);
+        controller.StartWorkers(2);
+
+        const auto recipe = Pipeline<>().Move<Data::MetalPipe>(station, cutter).Process(cutter);
+        Metrics::Histogram latency;
+        std::atomic<std::uint64_t> finished{0};
+        std::atomic<std::uint64_t> failed{0};
+        auto onDone = [&finished, &failed](bool succeeded) {
+            if (!succeeded) {
+                failed.fetch_add(1);
+            }
+            finished.fetch_add(1);
+            finished.notify_all();
+        };
+        const double seconds = Bench::TimeSeconds([&] {
+            for (std::uint64_t i = 0; i < ROUND_TRIPS; ++i) {
+                const auto start = std::chrono::steady_clock::now();
+                controller.Launch("bench-" + std::to_string(i), recipe, onDone);
+                WaitFor(finished, i + 1);
+                latency.Record(std::chrono::duration_cast<Clock::Duration>(std::chrono::steady_clock::now() - start));
+            }
+        });
+        if (failed.load() != 0) {
+            std::cerr << "pipeline_round_trip: " << failed.load() << " jobs failed\n";
+        }
+        Result result{"pipeline_round_trip", {{"workers", 2}}, ROUND_TRIPS, seconds};
+        result.latency = latency.Snapshot();
+        return result;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<Result> results;
+
+    for (size_t producers : {1, 2, 4, 8}) {
+        results.push_back(EnqueueThroughput(producers));
+    }
+    {
+        Controller controller(std::make_shared<Bench::NullClock>());
+        results.push_back(StepObserverDispatch(controller, false, 0));
+        for (int slots : {0, 1, 4}) {
+            results.push_back(StepObserverDispatch(controller, true, slots));
+        }
+    }
+    for (size_t threads : {1, 2, 4, 8}) {
+        results.push_back(StationTake(threads, 1));
+    }
+    for (size_t threads : {3, 6}) {
+        results.push_back(StationTake(threads, RAW_MATERIAL_KINDS.size()));
+    }
+    for (size_t size : {512, 4096, 8192}) {
+        results.push_back(BufferAllocation(size, 1));
+    }
+    results.push_back(BufferAllocation(1024, 4));
+    for (size_t capacity : {1, 4, 16}) {
+        results.push_back(MoverTrips(capacity));
+    }
+    results.push_back(ArenaHandoff(0, 1));
+    results.push_back(ArenaHandoff(4, 1));
+    results.push_back(ArenaHandoff(4, 4));
+    for (size_t threads : {1, 4}) {
+        results.push_back(JournalAppend(threads));
+    }
+    results.push_back(JournalRecovery());
+    results.push_back(JobRoundTrip());
+    results.push_back(PipelineRoundTrip());
+
+    if (argc > 1) {
+        std::ofstream out(argv[1]);
+        if (!out) {
+            std::cerr << "cannot open " << argv[1] << "\n";
+            return 1;
+        }
+        Bench::WriteJson(out, "swapk_bench", results);
+    } else {
+        Bench::WriteJson(std::cout, "swapk_bench", results);
+    }
+    Logging::Logger::Instance().Flush();
+    return 0;
+}
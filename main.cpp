@@ -2,37 +2,148 @@
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
 
 #include "Controller.hpp"
 #include "Machines/Cutter.hpp"
 
 using namespace Factory;
 
-int main() {
-    Controller controller;
+// Coroutine job: cuts `count` pipes, waiting for the station whenever it has no pipes in stock.
+// A pooled cutter may lose the delivered pipe to a sibling, or to a resumed journal job, so
+// cutting waits for material too.
+static JobCoroutine cutPipes(Machinery::ResourceStation& station, Machinery::Cutter<Data::MetalPipe>& cutter,
+                             int count) {
+    const auto timeout = std::chrono::milliseconds(MATERIAL_WAIT_TIMEOUT_MS);
+    for (int i = 0; i < count; ++i) {
+        StepStatus moved;
+        while ((moved = co_await Move(Data::MaterialKind::MetalPipe, station, cutter)) == RETRY || moved == BLOCKED) {
+            bool ready = moved == RETRY ? co_await WaitForMaterial(station, Data::MaterialKind::MetalPipe, timeout)
+                                        : co_await WaitForSpace(cutter, Data::MaterialKind::MetalPipe, timeout);
+            if (!ready) {
+                throw std::runtime_error("Timed out waiting for pipes or cutter space");
+            }
+        }
+        if (moved != SUCCESS) {
+            throw std::runtime_error("Pipe delivery failed");
+        }
+        StepStatus cut;
+        while ((cut = co_await Process(cutter, Data::MaterialKind::MetalPipe)) == RETRY || cut == BLOCKED) {
+            bool ready = cut == RETRY ? co_await WaitForMaterial(cutter, Data::MaterialKind::MetalPipe, timeout)
+                                      : co_await WaitForSpace(cutter, Data::MaterialKind::MetalPipeHalf, timeout);
+            if (!ready) {
+                throw std::runtime_error("Timed out waiting for a pipe or output space at the cutter");
+            }
+        }
+        if (cut != SUCCESS) {
+            throw std::runtime_error("Pipe cutting failed");
+        }
+    }
+}
+
+// Selects the simulation clock from the command line:
+//   swapk_exam                  real time
+//   swapk_exam scaled <factor>  real time sped up by <factor>
+//   swapk_exam virtual          as fast as possible
+static std::shared_ptr<Clock> makeClock(int argc, char* argv[]) {
+    std::string mode = argc > 1 ? argv[1] : "real";
+    if (mode == "scaled") {
+        double factor = argc > 2 ? std::stod(argv[2]) : 10.0;
+        FACTORY_LOG_INFO("[MAIN] Using scaled clock x", factor);
+        return std::make_shared<ScaledClock>(factor);
+    }
+    if (mode == "virtual") {
+        FACTORY_LOG_INFO("[MAIN] Using virtual clock");
+        return std::make_shared<VirtualClock>();
+    }
+    return std::make_shared<RealTimeClock>();
+}
+
+// Options after the clock arguments:
+//   swapk_exam virtual --trace trace.json   Chrome trace JSON, open in ui.perfetto.dev
+//   swapk_exam virtual --journal journal/   journal jobs and stock; a restart resumes where the last run stopped
+static const char* optionValue(int argc, char* argv[], const std::string& option) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (argv[i] == option) {
+            return argv[i + 1];
+        }
+    }
+    return nullptr;
+}
+
+int main(int argc, char* argv[]) {
+    Controller controller(makeClock(argc, argv));
+    const char* trace = optionValue(argc, argv, "--trace");
+    if (trace != nullptr) {
+        FACTORY_LOG_INFO("[MAIN] Tracing to ", trace);
+        Tracing::Tracer::Instance().Enable(controller.GetClock());
+    }
 
     // Type-safe machine registration using AddMachine<T>()
-    // The template dispatches to correct signal wiring via MachineTraits + SFINAE
-    auto& resourceStation = controller.AddMachine<Machinery::ResourceStation>("Resource_Station");
-    controller.StartResourceGeneration();
+    // The template dispatches to correct signal wiring via MachineTraits + SFINAE.
+    // Positions (meters) lay out the floor: station and dock on one side, cutters on the other,
+    // arms in between. Arm travel times follow from the distances.
+    auto& resourceStation = controller.AddMachine<Machinery::ResourceStation>(Machinery::Position{0, 0}, "Resource_Station");
+    auto& dock = controller.AddMachine<Machinery::Dock>(Machinery::Position{0, 2}, "Dock");
+
+    // Only pipes are consumed; the other kinds are capped instead of piling up forever
+    resourceStation.SetLimit(Data::MaterialKind::MetalPipe, {.capacity = 32, .highWatermark = 24, .lowWatermark = 16});
+    resourceStation.SetLimit(Data::MaterialKind::Gravel, {.capacity = 20, .highWatermark = 16, .lowWatermark = 8});
+    resourceStation.SetLimit(Data::MaterialKind::TitaniumSlab, {.capacity = 20, .highWatermark = 16, .lowWatermark = 8});
+
+    // Move steps are dispatched to whichever arm is least busy; moves from the same machine
+    // share a trip, up to four items per trip
+    auto& arm1 = controller.AddMachine<Machinery::Mover>(Machinery::Position{1, 0}, "Arm-1");
+    auto& arm2 = controller.AddMachine<Machinery::Mover>(Machinery::Position{1, 2}, "Arm-2");
+    for (auto* arm : {&arm1, &arm2}) {
+        arm->SetCapacity(4);
+    }
+    auto& cutter1 = controller.AddMachine<Machinery::Cutter<Data::MetalPipe>>(Machinery::Position{2, 0}, "Cutter-1");
+    // Cutters of the same type pool their work: idle ones steal cuts queued at Cutter-1
+    auto& cutter2 = controller.AddMachine<Machinery::Cutter<Data::MetalPipe>>(Machinery::Position{2, 1}, "Cutter-2");
+    auto& cutter3 = controller.AddMachine<Machinery::Cutter<Data::MetalPipe>>(Machinery::Position{2, 2}, "Cutter-3");
+    // Cuts queued at the same cutter share one blade setup
+    for (auto* cutter : {&cutter1, &cutter2, &cutter3}) {
+        cutter->SetMaxBatchSize(4);
+    }
+    // Room for the pipes of two jobs: both arms may reach the cutter with pipes of different
+    // jobs at once, and two half-delivered jobs must not fill the buffer between them
+    cutter1.SetLimit(Data::MaterialKind::MetalPipe, {.capacity = 4, .highWatermark = 4, .lowWatermark = 2});
 
-    auto& arm1 = controller.AddMachine<Machinery::Mover>("Arm-1");
-    auto& cutter1 = controller.AddMachine<Machinery::Cutter<Data::MetalPipe>>("Cutter-1");
+    // Every machine is registered and none holds material yet: resume the last run's stock and jobs
+    const char* journal = optionValue(argc, argv, "--journal");
+    if (journal != nullptr) {
+        const size_t resumed = controller.EnableJournal(journal);
+        FACTORY_LOG_INFO("[MAIN] Journaling to ", journal, ", resumed ", resumed, " jobs");
+    }
+    controller.StartResourceGeneration(GenerationMode::DemandDriven);
 
     // Give machines time to start their worker threads
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
+    // Each job: both pipes ride along on one arm trip, one batch cut of both pipes, then the
+    // halves go to the dock. An arm that drops pipes at the cutter takes halves waiting there
+    // on its way back. Typed, so moving the wrong material into the cutter does not compile.
+    const auto cutRecipe = Pipeline<>()
+        .Move<Data::MetalPipe>(resourceStation, cutter1, 2)
+        .Process(cutter1, 2)
+        .Move<Data::MetalPipeHalf>(cutter1, dock, 2);
+
     // Job counter for unique job names
     std::atomic<int> jobCounter{0};
 
     // Job factory lambda - creates demo jobs with unique names
     auto jobFactory = [&]() -> Job {
         int id = jobCounter.fetch_add(1);
-        Job job("job-" + std::to_string(id));
-        
-        // Each job: move material to cutter, process, move back
-        job.addStep(MoveStep{arm1, Data::MaterialKind::MetalPipe, resourceStation, cutter1});
-        job.addStep(ProcessStep{cutter1, Data::MaterialKind::MetalPipe, Data::MaterialKind::MetalPipeHalf});
+        Job job = cutRecipe.ToJob("job-" + std::to_string(id));
+
+        // Every fourth order is a rush order that should start within 5 seconds
+        if (id % 4 == 0) {
+            job.setPriority(JobPriority::Urgent);
+            job.setDeadline(controller.GetClock().Now() + std::chrono::seconds(5));
+        }
 
         return job;
     };
@@ -40,14 +151,68 @@ int main() {
     // Start worker pool with 2 workers
     controller.StartWorkers(2);
 
+    // Coroutine jobs run on the same workers alongside the spawned step-queue jobs
+    controller.Spawn("cut-batch", cutPipes(resourceStation, cutter1, 3));
+
+    // Recipes can also skip the job queue and run as direct calls on their machines. This one
+    // delivers a single pipe, so it never holds one cutter slot while waiting for another.
+    controller.Launch("cut-direct", Pipeline<>().Move<Data::MetalPipe>(resourceStation, cutter1).Process(cutter1));
+
     // Start job spawner - creates a new job every 2 seconds
     controller.StartJobSpawner(jobFactory, 2000);
 
-    std::cout << "\n=== Factory simulation running ===" << std::endl;
-    std::cout << "Press Enter to stop..." << std::endl;
+    FACTORY_LOG_INFO("\n=== Factory simulation running ===");
+    FACTORY_LOG_INFO("Press Enter to stop...");
     std::cin.get();
 
-    std::cout << "\n=== Shutting down ===" << std::endl;
+    FACTORY_LOG_INFO("\n=== Shutting down ===");
+
+    Metrics::LogMetrics(controller.CollectMetrics());
+
+    if (trace != nullptr) {
+        Tracing::Tracer::Instance().Disable();
+        std::ofstream out(trace);
+        const size_t events = Tracing::Tracer::Instance().WriteChromeTrace(out);
+        FACTORY_LOG_INFO("[MAIN] Wrote ", events, " trace events to ", trace);
+    }
+
+    const auto waits = controller.GetQueueWaitStats();
+    for (size_t c = 0; c < waits.size(); ++c) {
+        if (waits[c].served == 0) {
+            continue;
+        }
+        using std::chrono::duration_cast;
+        using std::chrono::milliseconds;
+        FACTORY_LOG_INFO("[QUEUE] ", toString(static_cast<JobPriority>(c)), ": served ", waits[c].served,
+                         " mean wait ", duration_cast<milliseconds>(waits[c].MeanWait()).count(), "ms max wait ",
+                         duration_cast<milliseconds>(waits[c].maxWait).count(), "ms missed deadlines ",
+                         waits[c].missedDeadlines);
+    }
+
+    for (const auto& pool : Data::BufferPool::Instance().Stats()) {
+        FACTORY_LOG_INFO("[POOL] ", pool.blockSize, "B blocks: hit rate ", pool.HitRate() * 100.0,
+                         "% live ", pool.live, " high-water ", pool.highWater);
+    }
+
+    for (const auto* arm : {&arm1, &arm2}) {
+        const auto trips = arm->GetTripStats();
+        using std::chrono::duration_cast;
+        using std::chrono::milliseconds;
+        FACTORY_LOG_INFO("[TRIPS] ", arm->Name(), ": ", trips.trips, " trips carried ", trips.loads, " materials, ",
+                         trips.chained, " chained; travelled ", duration_cast<milliseconds>(trips.loadedTravel).count(),
+                         "ms loaded and ", duration_cast<milliseconds>(trips.emptyTravel).count(), "ms empty");
+    }
+    FACTORY_LOG_INFO("[DOCK] shipped ", dock.Shipped(Data::MaterialKind::MetalPipeHalf), " pipe halves");
+
+    if (const auto* journaled = controller.GetJournal()) {
+        const auto stats = journaled->Stats();
+        FACTORY_LOG_INFO("[JOURNAL] appended ", stats.records, " records (", stats.bytes / 1024, " KiB) in ",
+                         stats.commits, " group commits, ", stats.compactions, " segments compacted, ",
+                         stats.dropped, " dropped");
+    }
+
+    const auto arena = Data::MaterialArena::Instance().Stats();
+    FACTORY_LOG_INFO("[ARENA] materials live ", arena.live, " high-water ", arena.highWater, " slots ", arena.slots);
 
     // Destructor handles graceful shutdown of:
     // - Job spawner